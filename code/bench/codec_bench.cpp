@@ -0,0 +1,102 @@
+// codec_bench.cpp
+// Compares the QOI codec with stb's PNG codec on real images: encode and decode speed in MB/s
+// of raw pixels, and compression ratio (raw pixel bytes / encoded bytes).
+//
+// Usage: ./bench/codec_bench [repetitions] [image ...]
+// (defaults to the large test images in ../code_windows and the die image)
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+#include "Qoi.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+// Runs work repetitions times and returns the throughput in MB/s of the given byte count
+static double measure(const std::function<void()> &work, size_t bytes, int repetitions)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++)
+    {
+        work();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return bytes * static_cast<double>(repetitions) / elapsed.count() / 1e6;
+}
+
+// stb_image_write callback that appends the encoded bytes to a vector
+static void append(void *context, void *data, int size)
+{
+    std::vector<uint8_t> *out = static_cast<std::vector<uint8_t> *>(context);
+    out->insert(out->end(), static_cast<uint8_t *>(data), static_cast<uint8_t *>(data) + size);
+}
+
+static void report(const std::string &codec, double encode, double decode, size_t rawBytes, size_t encodedBytes)
+{
+    std::cout << "  " << std::left << std::setw(6) << codec << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << encode << std::setw(12) << decode << std::setw(10) << std::setprecision(2)
+              << static_cast<double>(rawBytes) / encodedBytes << std::setw(12) << encodedBytes << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? std::atoi(argv[1]) : 5;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; i++)
+    {
+        files.push_back(argv[i]);
+    }
+    if (files.empty())
+    {
+        files = {"../code_windows/img_large_landscape.png", "../code_windows/img_large_portrait.png", "img_die.png"};
+    }
+
+    for (const std::string &file : files)
+    {
+        Image image(file);
+        int width = image.getWidth();
+        int height = image.getHeight();
+        int channels = image.getChannels();
+        size_t rawBytes = static_cast<size_t>(width) * height * channels;
+
+        std::cout << file << " (" << width << " x " << height << " x " << channels << ")" << std::endl;
+        std::cout << "  " << std::left << std::setw(6) << "codec" << std::right << std::setw(12) << "enc (MB/s)" << std::setw(12)
+                  << "dec (MB/s)" << std::setw(10) << "ratio" << std::setw(12) << "bytes" << std::endl;
+
+        // PNG through stb (encoded in memory, so only the codec is timed)
+        std::vector<uint8_t> png;
+        double pngEncode = measure([&]
+                                   {
+            png.clear();
+            stbi_write_png_to_func(append, &png, width, height, channels, image.getData(), image.getStride()); },
+                                   rawBytes, repetitions);
+        double pngDecode = measure([&]
+                                   {
+            int w, h, c;
+            stbi_image_free(stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &w, &h, &c, 0)); },
+                                   rawBytes, repetitions);
+        report("png", pngEncode, pngDecode, rawBytes, png.size());
+
+        // QOI (3- and 4-channel images only)
+        if (channels == 3 || channels == 4)
+        {
+            std::vector<uint8_t> encoded;
+            std::vector<uint8_t> decoded(rawBytes);
+            double qoiEncode = measure([&]
+                                       { encoded = qoi::encode(image.getData(), width, height, channels, image.getStride()); },
+                                       rawBytes, repetitions);
+            double qoiDecode = measure([&]
+                                       { qoi::decode(encoded.data(), encoded.size(), decoded.data(), static_cast<size_t>(width) * channels); },
+                                       rawBytes, repetitions);
+            report("qoi", qoiEncode, qoiDecode, rawBytes, encoded.size());
+        }
+    }
+
+    return 0;
+}
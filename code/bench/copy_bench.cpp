@@ -0,0 +1,82 @@
+// copy_bench.cpp
+// Counts the pixel bytes copied by each CLI function (add, subtract, dot, scale).
+//
+// For every function the result is handed to the output image twice: once by copy
+// assignment (what main.cpp did before Image had move semantics) and once by move
+// assignment (what it does now). The difference is the copying that moves remove.
+//
+// Usage: ./bench/copy_bench [image 1] [image 2] [dot image 1] [dot image 2]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <utility>
+
+#include "Image.h"
+
+// Runs one CLI function on copies of the inputs and returns the result
+static Image run(const std::string &function, const Image &a, const Image &b)
+{
+    if (function == "add")
+    {
+        return a + b;
+    }
+    if (function == "subtract")
+    {
+        return a - b;
+    }
+    if (function == "dot")
+    {
+        return a * b;
+    }
+
+    // scale (resize by half, as `./main scale <image> 0.5` does)
+    Image scaled = a;
+    scaled.resize(a.getWidth() / 2, a.getHeight() / 2);
+    return scaled;
+}
+
+// Bytes copied while producing the result and assigning it to the output image
+static size_t measure(const std::string &function, const Image &a, const Image &b, bool byMove)
+{
+    // Copies made inside the function itself (e.g. the scale input copy) count in both columns
+    Image output;
+    Matrix::resetBytesCopied();
+    Image result = run(function, a, b);
+    if (byMove)
+    {
+        output = std::move(result);
+    }
+    else
+    {
+        output = static_cast<const Image &>(result);
+    }
+    return Matrix::getBytesCopied();
+}
+
+int main(int argc, char **argv)
+{
+    std::string file1 = argc > 1 ? argv[1] : "img_die.png";
+    std::string file2 = argc > 2 ? argv[2] : "img_in_die.png";
+    std::string dotFile1 = argc > 3 ? argv[3] : "img_small_landscape.png";
+    std::string dotFile2 = argc > 4 ? argv[4] : "img_small_portrait.png";
+
+    Image image1(file1);
+    Image image2(file2);
+    Image dotImage1(dotFile1);
+    Image dotImage2(dotFile2);
+
+    std::cout << std::left << std::setw(10) << "function" << std::right << std::setw(16) << "copy (bytes)" << std::setw(16) << "move (bytes)" << std::endl;
+
+    const std::string functions[] = {"add", "subtract", "dot", "scale"};
+    for (const std::string &function : functions)
+    {
+        const Image &a = function == "dot" ? dotImage1 : image1;
+        const Image &b = function == "dot" ? dotImage2 : image2;
+        size_t copied = measure(function, a, b, false);
+        size_t moved = measure(function, a, b, true);
+        std::cout << std::left << std::setw(10) << function << std::right << std::setw(16) << copied << std::setw(16) << moved << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+// expr_check.cpp
+// Checks the expression templates (Expr.h) against the eager operators: the fused
+// lazy(a) * 0.5 + lazy(b) * 0.5 - lazy(c) must give the same bytes as (a + b) - c, and
+// lazy(a) - lazy(b) the same as a - b, through the Image and Matrix constructors and assignments.
+// Images have 1 to 4 channels, odd widths, and operands with padded row strides.
+//
+// Usage: ./bench/expr_check (exits with 1 and names the failing case on a mismatch)
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Expr.h"
+#include "Image.h"
+
+// Image of random pixels whose rows are padding bytes apart (0 for a contiguous image)
+static Image randomImage(int width, int height, int channels, int padding)
+{
+    Image image("", channels, width, height);
+    int stride = width * channels + padding;
+    if (padding > 0)
+    {
+        image.adopt(new uint8_t[static_cast<size_t>(stride) * height], height, width * channels, stride, [](uint8_t *buffer)
+                    { delete[] buffer; });
+    }
+    for (int y = 0; y < height; y++)
+    {
+        for (int i = 0; i < stride; i++)
+        {
+            image.row(y)[i] = static_cast<uint8_t>(std::rand());
+        }
+    }
+    return image;
+}
+
+// Whether two matrices hold the same bytes (printing the first difference if not)
+static bool same(const Matrix &expected, const Matrix &actual, const std::string &label)
+{
+    if (expected.getRows() != actual.getRows() || expected.getCols() != actual.getCols())
+    {
+        std::cout << "FAIL " << label << ": dimensions differ" << std::endl;
+        return false;
+    }
+    for (int y = 0; y < expected.getRows(); y++)
+    {
+        for (int i = 0; i < expected.getCols(); i++)
+        {
+            if (expected.row(y)[i] != actual.row(y)[i])
+            {
+                std::cout << "FAIL " << label << ": byte " << i << " of row " << y << " is " << static_cast<int>(actual.row(y)[i])
+                          << ", expected " << static_cast<int>(expected.row(y)[i]) << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::srand(1);
+    int failed = 0, run = 0;
+    for (int channels = 1; channels <= 4; channels++)
+    {
+        for (int width : {1, 7, 33, 101})
+        {
+            for (int height : {1, 5, 64})
+            {
+                std::string label = std::to_string(width) + " x " + std::to_string(height) + " x " + std::to_string(channels);
+                Image a = randomImage(width, height, channels, 13);
+                Image b = randomImage(width, height, channels, 0);
+                Image c = randomImage(width, height, channels, 3);
+
+                Image blend = (a + b) - c;
+                Image difference = a - b;
+
+                // Constructed from an expression, and assigned into images of another and of the same size
+                Image constructed = expr::lazy(a) * 0.5 + expr::lazy(b) * 0.5 - expr::lazy(c);
+                Image resized;
+                resized = expr::lazy(a) * 0.5 + expr::lazy(b) * 0.5 - expr::lazy(c);
+                Image reused = randomImage(width, height, channels, 0);
+                reused = expr::lazy(a) - expr::lazy(b);
+
+                // The same through the Matrix overloads (one byte per element)
+                const Matrix &ma = a, &mb = b, &mc = c;
+                Matrix matrix = expr::lazy(ma) * 0.5 + 0.5 * expr::lazy(mb) - expr::lazy(mc);
+
+                run += 4;
+                failed += same(blend, constructed, "Image(expression) " + label) ? 0 : 1;
+                failed += same(blend, resized, "Image = expression " + label) ? 0 : 1;
+                failed += same(difference, reused, "Image = lazy(a) - lazy(b) " + label) ? 0 : 1;
+                failed += same(blend, matrix, "Matrix(expression) " + label) ? 0 : 1;
+            }
+        }
+    }
+
+    std::cout << (failed == 0 ? "expr: all " : "expr: ") << run - failed << " of " << run << " expressions match the eager operators" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
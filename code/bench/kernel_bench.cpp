@@ -0,0 +1,83 @@
+// kernel_bench.cpp
+// Measures the throughput of the per-byte pixel kernels and the packed/planar conversions on an
+// 8K RGBA frame.
+// The kernels use the widest instruction set the CPU supports; run with
+// IMAGE_SIMD=scalar (or sse2, avx2) to compare against a narrower one.
+//
+// Usage: ./bench/kernel_bench [repetitions]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Kernels.h"
+
+// Runs a kernel over the frame and returns the throughput in MB/s (of output written)
+template <typename Kernel>
+static double measure(Kernel kernel, const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, std::vector<uint8_t> &out, int repetitions)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++)
+    {
+        kernel(a.data(), b.data(), out.data(), out.size());
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return out.size() * static_cast<double>(repetitions) / elapsed.count() / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? std::atoi(argv[1]) : 20;
+
+    // 7680 x 4320 RGBA
+    size_t bytes = static_cast<size_t>(7680) * 4320 * 4;
+    std::vector<uint8_t> a(bytes), b(bytes), out(bytes);
+    for (size_t i = 0; i < bytes; i++)
+    {
+        a[i] = static_cast<uint8_t>(i * 31);
+        b[i] = static_cast<uint8_t>(i * 17 + 5);
+    }
+
+    std::cout << "instruction set: " << kernels::activeIsa() << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(18) << "addSaturate" << measure(kernels::addSaturate, a, b, out, repetitions) << " MB/s" << std::endl;
+    std::cout << std::left << std::setw(18) << "subtractSaturate" << measure(kernels::subtractSaturate, a, b, out, repetitions) << " MB/s" << std::endl;
+    std::cout << std::left << std::setw(18) << "average" << measure(kernels::average, a, b, out, repetitions) << " MB/s" << std::endl;
+
+    // Brightness scaling by 0.8 (fixed-point path) and by 0.7 (no exact 16-bit factor, lookup table path)
+    kernels::ScaleTable dim = kernels::makeScaleTable(0.8);
+    kernels::ScaleTable lookup = kernels::makeScaleTable(0.7);
+    auto scaleDim = [&dim](const uint8_t *in, const uint8_t *, uint8_t *result, size_t count)
+    { kernels::scale(in, result, count, dim); };
+    auto scaleLookup = [&lookup](const uint8_t *in, const uint8_t *, uint8_t *result, size_t count)
+    { kernels::scale(in, result, count, lookup); };
+    std::cout << std::left << std::setw(18) << "scale 0.8" << measure(scaleDim, a, b, out, repetitions) << " MB/s" << std::endl;
+    std::cout << std::left << std::setw(18) << "scale 0.7 (lut)" << measure(scaleLookup, a, b, out, repetitions) << " MB/s" << std::endl;
+
+    // Packed to planar and back, for RGBA (the whole frame) and RGB (three quarters of it)
+    size_t pixels = bytes / 4;
+    std::vector<uint8_t> rgb(a.begin(), a.begin() + pixels * 3), rgbOut(pixels * 3);
+    for (int channels = 4; channels >= 3; channels--)
+    {
+        const std::vector<uint8_t> &packed = channels == 4 ? a : rgb;
+        std::vector<uint8_t> &result = channels == 4 ? out : rgbOut;
+        auto split = [&](const uint8_t *, const uint8_t *, uint8_t *planar, size_t)
+        {
+            uint8_t *planes[4] = {planar, planar + pixels, planar + 2 * pixels, planar + 3 * pixels};
+            kernels::deinterleave(packed.data(), planes, pixels, channels);
+        };
+        auto join = [&](const uint8_t *planar, const uint8_t *, uint8_t *interleaved, size_t)
+        {
+            const uint8_t *planes[4] = {planar, planar + pixels, planar + 2 * pixels, planar + 3 * pixels};
+            kernels::interleave(planes, interleaved, pixels, channels);
+        };
+        std::string name = channels == 4 ? "RGBA" : "RGB";
+        std::cout << std::left << std::setw(18) << "deinterleave " + name << measure(split, a, b, result, repetitions) << " MB/s" << std::endl;
+        std::cout << std::left << std::setw(18) << "interleave " + name << measure(join, a, b, result, repetitions) << " MB/s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+// png_check.cpp
+// Round trip of the PNG encoder (Png.h) at each of its levels (stored, rle, fast): synthetic
+// images are encoded, then checked independently of the encoder's own code. Every chunk's CRC is
+// recomputed bit by bit, the joined IDAT zlib stream is inflated by stb_image and its Adler-32
+// trailer recomputed, and stb_image decodes the file back to the original pixels. The images cover
+// 1 to 4 channels, widths that are not a multiple of 8, padded row strides, and images over the
+// encoder's 512 KiB row groups (several deflate groups joined into one stream).
+//
+// Usage: ./bench/png_check (exits with 1 and names the failing case on a mismatch)
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Png.h"
+#include "stb_image.h"
+
+// Value of channel c of pixel (x, y) of a synthetic image
+typedef std::function<uint8_t(int x, int y, int c)> Pattern;
+
+// Reference CRC-32 (bitwise, reflected polynomial 0xEDB88320)
+static uint32_t referenceCrc(const uint8_t *data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Reference Adler-32
+static uint32_t referenceAdler(const uint8_t *data, size_t size)
+{
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static uint32_t readBigEndian(const uint8_t *bytes)
+{
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+// Walks the chunks checking their CRCs, and returns the joined IDAT data (throws on a bad file)
+static std::vector<uint8_t> checkChunks(const std::vector<uint8_t> &file)
+{
+    const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    if (file.size() < 8 || !std::equal(signature, signature + 8, file.begin()))
+    {
+        throw std::runtime_error("bad signature");
+    }
+
+    std::vector<uint8_t> idat;
+    bool ended = false;
+    for (size_t offset = 8; !ended;)
+    {
+        if (offset + 12 > file.size())
+        {
+            throw std::runtime_error("truncated chunk at " + std::to_string(offset));
+        }
+        uint32_t length = readBigEndian(&file[offset]);
+        if (offset + 12 + length > file.size())
+        {
+            throw std::runtime_error("chunk past the end of the file at " + std::to_string(offset));
+        }
+        std::string type(file.begin() + offset + 4, file.begin() + offset + 8);
+        if (referenceCrc(&file[offset + 4], length + 4) != readBigEndian(&file[offset + 8 + length]))
+        {
+            throw std::runtime_error("bad CRC in " + type + " chunk at " + std::to_string(offset));
+        }
+        if (type == "IDAT")
+        {
+            idat.insert(idat.end(), file.begin() + offset + 8, file.begin() + offset + 8 + length);
+        }
+        ended = type == "IEND";
+        offset += 12 + length;
+        if (ended && offset != file.size())
+        {
+            throw std::runtime_error("data after IEND");
+        }
+    }
+    return idat;
+}
+
+// Encodes one image at one level and checks the file, reporting whether it passed (printing why not)
+static bool roundTrip(const std::string &name, const Pattern &pattern, int width, int height, int channels, png::Effort effort,
+                      const char *level)
+{
+    size_t rowBytes = static_cast<size_t>(width) * channels;
+    size_t stride = rowBytes + 5;
+    std::vector<uint8_t> pixels(stride * height, 0xCD);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                pixels[y * stride + x * channels + c] = pattern(x, y, c);
+            }
+        }
+    }
+
+    std::string label = std::string(level) + " " + name + " (" + std::to_string(width) + " x " + std::to_string(height) + " x " +
+                        std::to_string(channels) + ")";
+    try
+    {
+        std::vector<uint8_t> file = png::encode(pixels.data(), width, height, channels, stride, effort);
+        std::vector<uint8_t> idat = checkChunks(file);
+
+        // The zlib stream inflates to one filter byte plus one row per row, and its trailer matches
+        int inflatedSize = 0;
+        char *inflated = stbi_zlib_decode_malloc(reinterpret_cast<const char *>(idat.data()), static_cast<int>(idat.size()), &inflatedSize);
+        if (inflated == nullptr)
+        {
+            throw std::runtime_error("zlib stream does not inflate");
+        }
+        uint32_t adler = referenceAdler(reinterpret_cast<const uint8_t *>(inflated), inflatedSize);
+        stbi_image_free(inflated);
+        if (static_cast<size_t>(inflatedSize) != (rowBytes + 1) * height)
+        {
+            throw std::runtime_error("inflated to " + std::to_string(inflatedSize) + " bytes");
+        }
+        if (idat.size() < 4 || adler != readBigEndian(&idat[idat.size() - 4]))
+        {
+            throw std::runtime_error("bad Adler-32");
+        }
+
+        int decodedWidth = 0, decodedHeight = 0, decodedChannels = 0;
+        uint8_t *decoded = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &decodedWidth, &decodedHeight, &decodedChannels, 0);
+        if (decoded == nullptr)
+        {
+            throw std::runtime_error(std::string("stb_image: ") + stbi_failure_reason());
+        }
+        bool same = decodedWidth == width && decodedHeight == height && decodedChannels == channels;
+        for (int y = 0; same && y < height; y++)
+        {
+            same = std::equal(decoded + y * rowBytes, decoded + (y + 1) * rowBytes, pixels.begin() + y * stride);
+        }
+        stbi_image_free(decoded);
+        if (!same)
+        {
+            throw std::runtime_error("decoded pixels differ");
+        }
+        return true;
+    }
+    catch (const std::exception &error)
+    {
+        std::cout << "FAIL " << label << ": " << error.what() << std::endl;
+        return false;
+    }
+}
+
+int main()
+{
+    std::srand(1);
+    std::vector<uint8_t> noise(1 << 20);
+    for (uint8_t &value : noise)
+    {
+        value = static_cast<uint8_t>(std::rand());
+    }
+
+    const std::vector<std::pair<std::string, Pattern>> patterns = {
+        // Long runs of one value (rle matches, and matches longer than 258 bytes)
+        {"bands", [](int x, int y, int c) { return static_cast<uint8_t>((y / 9) * 31 + c); }},
+        // Small differences (Sub and Up filters leave few distinct values)
+        {"gradient", [](int x, int y, int c) { return static_cast<uint8_t>(x * (c + 1) + y * 2); }},
+        // A tile repeated at a distance (LZ77 matches further back than one pixel)
+        {"tiles", [](int x, int y, int c) { return static_cast<uint8_t>(((x % 23) * 11 + (y % 17) * 7) ^ (c * 40)); }},
+        // Incompressible bytes (literals, and stored blocks longer than 64 KiB)
+        {"noise", [&](int x, int y, int c) { return noise[(static_cast<size_t>(y) * 4099 + x * 4 + c) % noise.size()]; }}};
+
+    // 701 x 900 is over 512 KiB (several row groups) at every channel count, 1021 x 300 from 2 channels
+    const int sizes[][2] = {{1, 1}, {13, 7}, {333, 171}, {1021, 300}, {701, 900}};
+
+    const png::Effort efforts[] = {png::Effort::stored, png::Effort::rle, png::Effort::fast};
+    const char *levels[] = {"stored", "rle", "fast"};
+
+    int failed = 0, run = 0;
+    for (int e = 0; e < 3; e++)
+    {
+        for (int channels = 1; channels <= 4; channels++)
+        {
+            for (const auto &pattern : patterns)
+            {
+                for (const auto &size : sizes)
+                {
+                    run++;
+                    failed += roundTrip(pattern.first, pattern.second, size[0], size[1], channels, efforts[e], levels[e]) ? 0 : 1;
+                }
+            }
+        }
+    }
+
+    std::cout << (failed == 0 ? "png: all " : "png: ") << run - failed << " of " << run << " round trips lossless" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// qoi_check.cpp
+// Round trip of the QOI codec: synthetic images are encoded, decoded and compared pixel for pixel.
+// The images exercise every chunk type: runs longer than 62 pixels and runs that continue across
+// rows (QOI_OP_RUN), repeated colors (QOI_OP_INDEX), small and medium changes (QOI_OP_DIFF,
+// QOI_OP_LUMA), arbitrary colors (QOI_OP_RGB) and alpha changes (QOI_OP_RGBA), for 3 and 4
+// channels, with padded row strides on both sides.
+//
+// Usage: ./bench/qoi_check (exits with 1 and names the failing case on a mismatch)
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Qoi.h"
+
+// Value of channel c of pixel (x, y) of a synthetic image
+typedef std::function<uint8_t(int x, int y, int c)> Pattern;
+
+// Encodes and decodes one image, and reports whether the pixels came back unchanged (printing why not)
+static bool roundTrip(const std::string &name, const Pattern &pattern, int width, int height, int channels)
+{
+    // Both strides are padded, the source with bytes that must not leak into the file
+    size_t inputStride = static_cast<size_t>(width) * channels + 7;
+    size_t outputStride = static_cast<size_t>(width) * channels + 3;
+    std::vector<uint8_t> pixels(inputStride * height, 0xAB);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                pixels[y * inputStride + x * channels + c] = pattern(x, y, c);
+            }
+        }
+    }
+
+    std::string label = name + " (" + std::to_string(width) + " x " + std::to_string(height) + " x " + std::to_string(channels) + ")";
+    try
+    {
+        std::vector<uint8_t> encoded = qoi::encode(pixels.data(), width, height, channels, inputStride);
+        qoi::Header header = qoi::readHeader(encoded.data(), encoded.size());
+        if (header.width != width || header.height != height || header.channels != channels)
+        {
+            std::cout << "FAIL " << label << ": header " << header.width << " x " << header.height << " x " << header.channels << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> decoded(outputStride * height, 0);
+        qoi::decode(encoded.data(), encoded.size(), decoded.data(), outputStride);
+        for (int y = 0; y < height; y++)
+        {
+            for (size_t i = 0; i < static_cast<size_t>(width) * channels; i++)
+            {
+                if (decoded[y * outputStride + i] != pixels[y * inputStride + i])
+                {
+                    std::cout << "FAIL " << label << ": byte " << i << " of row " << y << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    catch (const std::exception &error)
+    {
+        std::cout << "FAIL " << label << ": " << error.what() << std::endl;
+        return false;
+    }
+}
+
+int main()
+{
+    std::srand(1);
+    std::vector<uint8_t> noise(1 << 20);
+    for (uint8_t &value : noise)
+    {
+        value = static_cast<uint8_t>(std::rand());
+    }
+
+    const std::vector<std::pair<std::string, Pattern>> patterns = {
+        // One color: a single run over the whole image, so runs cross every row
+        {"solid", [](int, int, int c) { return static_cast<uint8_t>(40 + c); }},
+        // Runs of 150 pixels, longer than one run chunk holds and starting mid-row
+        {"long runs", [](int x, int y, int c) { return static_cast<uint8_t>(((y * 37 + x) / 150) * 50 + c); }},
+        // Small steps between neighbours (diff and luma chunks), wrapping around 255
+        {"gradient", [](int x, int y, int c) { return static_cast<uint8_t>(x * (c + 1) + y * 3 + 250); }},
+        // A few colors repeated out of order (index chunks)
+        {"palette", [](int x, int y, int c) { return static_cast<uint8_t>(((x * 7 + y * 13) % 5) * 60 + c * 11); }},
+        // Unrelated neighbours (full color chunks), alpha changing every pixel for RGBA
+        {"noise", [&](int x, int y, int c) { return noise[(static_cast<size_t>(y) * 4099 + x * 4 + c) % noise.size()]; }},
+        // Smooth color with alpha changes only now and then
+        {"alpha steps", [](int x, int y, int c) { return static_cast<uint8_t>(c == 3 ? (x / 16) * 17 : x + y); }}};
+
+    const int sizes[][2] = {{1, 1}, {5, 40}, {200, 3}, {63, 64}, {333, 171}};
+
+    int failed = 0, run = 0;
+    for (int channels : {3, 4})
+    {
+        for (const auto &pattern : patterns)
+        {
+            for (const auto &size : sizes)
+            {
+                run++;
+                failed += roundTrip(pattern.first, pattern.second, size[0], size[1], channels) ? 0 : 1;
+            }
+        }
+    }
+
+    std::cout << (failed == 0 ? "qoi: all " : "qoi: ") << run - failed << " of " << run << " round trips lossless" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// resize_bench.cpp
+// Compares the native resampler (Resample.h) with stb_image_resize on real images: time per
+// resize and output megapixels per second for each filter, and the mean absolute difference of
+// each filter's output from stbir's. The native filters run on the shared thread pool; stbir
+// uses one thread.
+//
+// Usage: ./bench/resize_bench [repetitions] [threads] [image ...]
+// (defaults to the large test images in ../code_windows; threads 0 = one per core)
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+#include "Resample.h"
+#include "ResizeContext.h"
+#include "ThreadPool.h"
+
+// Mean absolute difference between two images of the same dimensions
+static double meanDifference(const Image &a, const Image &b)
+{
+    size_t rowBytes = static_cast<size_t>(a.getWidth()) * a.getChannels();
+    double total = 0.0;
+    for (int y = 0; y < a.getHeight(); y++)
+    {
+        const uint8_t *rowA = a.getData() + static_cast<size_t>(y) * a.getStride();
+        const uint8_t *rowB = b.getData() + static_cast<size_t>(y) * b.getStride();
+        for (size_t i = 0; i < rowBytes; i++)
+        {
+            total += std::abs(rowA[i] - rowB[i]);
+        }
+    }
+    return total / (rowBytes * a.getHeight());
+}
+
+int main(int argc, char **argv)
+{
+    int repetitions = argc > 1 ? std::atoi(argv[1]) : 5;
+    if (argc > 2)
+    {
+        ThreadPool::setSharedThreadCount(std::atoi(argv[2]));
+    }
+    std::vector<std::string> files;
+    for (int i = 3; i < argc; i++)
+    {
+        files.push_back(argv[i]);
+    }
+    if (files.empty())
+    {
+        files = {"../code_windows/img_large_landscape.png", "../code_windows/img_large_portrait.png"};
+    }
+
+    const std::vector<double> factors = {0.5, 0.25, 0.37, 1.6};
+    const std::vector<resample::Filter> filters = {resample::Filter::stbir, resample::Filter::box, resample::Filter::bilinear,
+                                                   resample::Filter::bicubic, resample::Filter::lanczos3};
+    const char *names[] = {"stbir", "box", "bilinear", "bicubic", "lanczos3"};
+
+    std::cout << "threads: " << ThreadPool::shared().getThreadCount() << std::endl;
+    for (const std::string &file : files)
+    {
+        Image image(file);
+        std::cout << file << " (" << image.getWidth() << " x " << image.getHeight() << " x " << image.getChannels() << ")" << std::endl;
+
+        for (double factor : factors)
+        {
+            int width = static_cast<int>(image.getWidth() * factor);
+            int height = static_cast<int>(image.getHeight() * factor);
+            std::cout << "  x" << factor << " -> " << width << " x " << height << std::endl;
+            std::cout << "    " << std::left << std::setw(10) << "filter" << std::right << std::setw(10) << "ms" << std::setw(12)
+                      << "MPix/s" << std::setw(12) << "speedup" << std::setw(12) << "diff" << std::endl;
+
+            Image reference;
+            double stbirTime = 0.0;
+            for (size_t f = 0; f < filters.size(); f++)
+            {
+                // One context per filter, so the timed runs reuse the weights and working memory
+                ResizeContext context;
+                Image resized(file, image.getChannels(), width, height);
+                auto run = [&]
+                {
+                    context.resize(image.getData(), image.getWidth(), image.getHeight(), image.getStride(),
+                                   resized.getData(), width, height, resized.getStride(), image.getChannels(), filters[f]);
+                };
+                run();
+
+                auto start = std::chrono::steady_clock::now();
+                for (int r = 0; r < repetitions; r++)
+                {
+                    run();
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                double seconds = elapsed.count() / repetitions;
+
+                if (f == 0)
+                {
+                    reference = resized;
+                    stbirTime = seconds;
+                }
+                std::cout << "    " << std::left << std::setw(10) << names[f] << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(10) << seconds * 1e3 << std::setw(12) << static_cast<double>(width) * height / seconds / 1e6
+                          << std::setw(11) << stbirTime / seconds << "x" << std::setw(12) << meanDifference(reference, resized) << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
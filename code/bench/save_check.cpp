@@ -0,0 +1,121 @@
+// save_check.cpp
+// Saves images over the file they were loaded from, in every output format and read mode. With
+// --io mmap the pixels of an uncompressed input are mapped from the file itself, so a writer that
+// truncated the target in place would crash (SIGBUS) or leave it empty; the file must instead be
+// replaced whole, decode to the same pixels, and leave no temporary file behind.
+//
+// Usage: ./bench/save_check (exits with 1 and names the failing case on a mismatch)
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "FileIO.h"
+#include "Image.h"
+#include "Png.h"
+
+// Whether two images hold the same pixels (printing the first difference if not)
+static bool samePixels(const Image &expected, const Image &actual, const std::string &label)
+{
+    if (expected.getWidth() != actual.getWidth() || expected.getHeight() != actual.getHeight() ||
+        expected.getChannels() != actual.getChannels())
+    {
+        std::cout << "FAIL " << label << ": dimensions differ" << std::endl;
+        return false;
+    }
+    for (int y = 0; y < expected.getHeight(); y++)
+    {
+        for (int i = 0; i < expected.getWidth() * expected.getChannels(); i++)
+        {
+            if (expected.row(y)[i] != actual.row(y)[i])
+            {
+                std::cout << "FAIL " << label << ": byte " << i << " of row " << y << " differs" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Loads path with the given read mode, saves it over itself, and checks the file that results
+static bool saveOverInput(const Image &source, const std::string &path, fileio::ReadMode mode, const std::string &label)
+{
+    try
+    {
+        source.save(path);
+        fileio::setReadMode(mode);
+        {
+            Image loaded(path);
+            loaded.save(path);
+        }
+        fileio::setReadMode(fileio::ReadMode::stdio);
+        if (!samePixels(source, Image(path), label))
+        {
+            return false;
+        }
+    }
+    catch (const std::exception &error)
+    {
+        fileio::setReadMode(fileio::ReadMode::stdio);
+        std::cout << "FAIL " << label << ": " << error.what() << std::endl;
+        return false;
+    }
+
+    for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::path(path).parent_path()))
+    {
+        if (entry.path().extension() == ".tmp")
+        {
+            std::cout << "FAIL " << label << ": temporary file " << entry.path().string() << " left behind" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::srand(1);
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "save_check";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // Odd width, so PNG and PAM rows are not a multiple of any vector width
+    Image source("", 3, 67, 41);
+    for (int y = 0; y < source.getHeight(); y++)
+    {
+        for (int i = 0; i < source.getWidth() * source.getChannels(); i++)
+        {
+            source.row(y)[i] = static_cast<uint8_t>(std::rand());
+        }
+    }
+
+    const fileio::ReadMode modes[] = {fileio::ReadMode::stdio, fileio::ReadMode::mmap, fileio::ReadMode::pread};
+    const char *modeNames[] = {"stdio", "mmap", "pread"};
+    int failed = 0, run = 0;
+    for (const char *extension : {".pam", ".ppm", ".raw", ".qoi", ".png"})
+    {
+        // PNG is written by this repo's encoder below effort best, and by stb_image_write at best
+        for (png::Effort effort : {png::Effort::fast, png::Effort::best})
+        {
+            if (effort == png::Effort::best && std::string(extension) != ".png")
+            {
+                continue;
+            }
+            png::setEffort(effort);
+            for (int m = 0; m < 3; m++)
+            {
+                std::string label = std::string(extension) + " --io " + modeNames[m] + (effort == png::Effort::best ? " (stb)" : "");
+                std::string path = (directory / (std::string("image") + extension)).string();
+                run++;
+                failed += saveOverInput(source, path, modes[m], label) ? 0 : 1;
+            }
+        }
+    }
+    std::filesystem::remove_all(directory);
+
+    std::cout << (failed == 0 ? "save: all " : "save: ") << run - failed << " of " << run << " saves over the input are intact" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
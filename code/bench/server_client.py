@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# server_client.py
+#
+# Client for `./main serve <socket path>`: sends the same request repeatedly over one or more
+# connections and reports throughput and latency, for comparing against one process per image.
+#
+# Usage:
+#   ./bench/server_client.py <socket path> <op> <input 1> [<input 2>] <output> [options]
+#   ./bench/server_client.py /tmp/image.sock add img_die.png img_in_die.png out/sum.png -n 200 -c 2
+#   ./bench/server_client.py /tmp/image.sock pipe img_die.png out/p.png --stages 'resize 0.5 | scale 0.8'
+#   ./bench/server_client.py /tmp/image.sock shutdown
+
+import argparse
+import json
+import socket
+import statistics
+import sys
+import threading
+import time
+
+
+def connect(path):
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(path)
+    return client, client.makefile("rb")
+
+
+def send(client, reader, request):
+    client.sendall((json.dumps(request) + "\n").encode())
+    line = reader.readline()
+    if not line:
+        raise RuntimeError("server closed the connection")
+    return json.loads(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark client for ./main serve")
+    parser.add_argument("socket")
+    parser.add_argument("op", choices=["add", "subtract", "dot", "scale", "pipe", "shutdown"])
+    parser.add_argument("files", nargs="*", help="inputs followed by the output")
+    parser.add_argument("--alpha", type=float, help="factor for scale")
+    parser.add_argument("--stages", help="stages for pipe, e.g. 'resize 0.5 | scale 0.8'")
+    parser.add_argument("-n", "--requests", type=int, default=100, help="requests per connection")
+    parser.add_argument("-c", "--connections", type=int, default=1, help="concurrent connections")
+    args = parser.parse_args()
+
+    if args.op == "shutdown":
+        client, reader = connect(args.socket)
+        print(send(client, reader, {"op": "shutdown"}))
+        return 0
+
+    if len(args.files) < 2:
+        parser.error("need at least one input and an output")
+
+    request = {"op": args.op, "inputs": args.files[:-1], "output": args.files[-1]}
+    if args.alpha is not None:
+        request["alpha"] = args.alpha
+    if args.stages is not None:
+        request["stages"] = args.stages
+
+    latencies = []
+    errors = []
+    lock = threading.Lock()
+
+    def run():
+        client, reader = connect(args.socket)
+        for _ in range(args.requests):
+            start = time.perf_counter()
+            reply = send(client, reader, request)
+            elapsed = time.perf_counter() - start
+            with lock:
+                latencies.append(elapsed)
+                if not reply.get("ok"):
+                    errors.append(reply.get("error"))
+        client.close()
+
+    start = time.perf_counter()
+    threads = [threading.Thread(target=run) for _ in range(args.connections)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    total = time.perf_counter() - start
+
+    latencies.sort()
+    print("requests    %d (%d failed)" % (len(latencies), len(errors)))
+    print("throughput  %.1f requests/s" % (len(latencies) / total))
+    print("latency     mean %.3f ms, p50 %.3f ms, p99 %.3f ms" % (
+        statistics.mean(latencies) * 1e3,
+        latencies[len(latencies) // 2] * 1e3,
+        latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))] * 1e3))
+    if errors:
+        print("first error: %s" % errors[0], file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,226 @@
+// Batch.cpp
+
+#include "Batch.h"
+#include "BoundedQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace
+{
+    // One file moving through the stages
+    struct Job
+    {
+        std::string input;
+        std::string output;
+        Image image;
+    };
+
+    // Extensions stb_image or the uncompressed formats can decode
+    bool isImageFile(const std::filesystem::path &path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" ||
+               extension == ".tga" || extension == ".gif" || extension == ".psd" || extension == ".hdr" ||
+               extension == ".pic" || extension == ".pgm" || extension == ".ppm" || extension == ".pam" || extension == ".raw" ||
+               extension == ".qoi";
+    }
+
+    // Starts count threads running body, and returns them
+    std::vector<std::thread> startWorkers(int count, const std::function<void()> &body)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < std::max(count, 1); i++)
+        {
+            threads.emplace_back(body);
+        }
+        return threads;
+    }
+
+    void joinAll(std::vector<std::thread> &threads)
+    {
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Output path of every input: <directory>/<stem><extension>, unless two inputs share a stem
+    // (a.png and a.jpg, or the same name in two directories), in which case those inputs keep their
+    // original extension (a_png, a_jpg) and, if that still collides, their index in the list (a_png_3)
+    std::vector<std::string> outputPaths(const std::vector<std::string> &inputs, const std::string &directory,
+                                         const std::string &extension)
+    {
+        std::vector<std::string> names;
+        std::map<std::string, int> counts;
+        for (const std::string &input : inputs)
+        {
+            names.push_back(std::filesystem::path(input).stem().string());
+            counts[names.back()]++;
+        }
+
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            if (counts[std::filesystem::path(inputs[i]).stem().string()] > 1)
+            {
+                std::string original = std::filesystem::path(inputs[i]).extension().string();
+                names[i] += "_" + (original.empty() ? std::string("none") : original.substr(1));
+            }
+        }
+
+        std::map<std::string, int> renamed;
+        for (const std::string &name : names)
+        {
+            renamed[name]++;
+        }
+        std::set<std::string> used;
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            std::string name = renamed[names[i]] > 1 ? names[i] + "_" + std::to_string(i) : names[i];
+            while (!used.insert(name).second)
+            {
+                // (only when an indexed name equals another input's own name)
+                name += "_" + std::to_string(i);
+            }
+            paths.push_back((std::filesystem::path(directory) / name).string() + extension);
+        }
+        return paths;
+    }
+}
+
+std::vector<std::string> batch::listInputs(const std::string &path)
+{
+    std::vector<std::string> inputs;
+
+    if (std::filesystem::is_directory(path))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file() && isImageFile(entry.path()))
+            {
+                inputs.push_back(entry.path().string());
+            }
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    // Otherwise the path is a manifest with one input per line
+    std::ifstream manifest(path);
+    if (!manifest)
+    {
+        throw std::runtime_error("Error (Batch.cpp_listInputs): could not open " + path);
+    }
+    for (std::string line; std::getline(manifest, line);)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty() && line[0] != '#')
+        {
+            inputs.push_back(line);
+        }
+    }
+    return inputs;
+}
+
+batch::Result batch::run(const std::vector<std::string> &inputs, const Pipeline &pipeline, const std::string &outputDirectory,
+                         const Options &options, std::ostream &errors)
+{
+    std::filesystem::create_directories(outputDirectory);
+    std::vector<std::string> outputs = outputPaths(inputs, outputDirectory, options.outputExtension);
+
+    BoundedQueue<Job> decoded(options.queueDepth);
+    BoundedQueue<Job> processed(options.queueDepth);
+
+    std::atomic<size_t> nextInput(0);
+    std::atomic<size_t> done(0);
+    std::atomic<size_t> failed(0);
+
+    // Per-file errors are reported without stopping the batch
+    std::mutex errorsMutex;
+    auto fail = [&](const Job &job, const std::exception &error)
+    {
+        std::lock_guard<std::mutex> lock(errorsMutex);
+        errors << job.input << ": " << error.what() << std::endl;
+        failed++;
+    };
+
+    // Stage one: decode the inputs in order of their index
+    std::vector<std::thread> decoders = startWorkers(options.decodeWorkers, [&]
+                                                     {
+        for (size_t i = nextInput++; i < inputs.size(); i = nextInput++)
+        {
+            Job job;
+            job.input = inputs[i];
+            job.output = outputs[i];
+            try
+            {
+                job.image = Image(job.input);
+            }
+            catch (const std::exception &error)
+            {
+                fail(job, error);
+                continue;
+            }
+            decoded.push(std::move(job));
+        } });
+
+    // Stage two: run the pipeline
+    std::vector<std::thread> workers = startWorkers(options.computeWorkers, [&]
+                                                    {
+        for (Job job; decoded.pop(job);)
+        {
+            try
+            {
+                pipeline.run(job.image);
+            }
+            catch (const std::exception &error)
+            {
+                fail(job, error);
+                continue;
+            }
+            processed.push(std::move(job));
+        } });
+
+    // Stage three: encode the results
+    std::vector<std::thread> encoders = startWorkers(options.encodeWorkers, [&]
+                                                     {
+        for (Job job; processed.pop(job);)
+        {
+            try
+            {
+                job.image.save(job.output);
+                done++;
+            }
+            catch (const std::exception &error)
+            {
+                fail(job, error);
+            }
+        } });
+
+    // Each queue is closed once every producer of the stage before it has finished
+    joinAll(decoders);
+    decoded.close();
+    joinAll(workers);
+    processed.close();
+    joinAll(encoders);
+
+    Result result;
+    result.processed = done;
+    result.failed = failed;
+    return result;
+}
@@ -0,0 +1,59 @@
+// Batch.h
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Pipeline.h"
+
+// Batch processing of many images through one Pipeline. Decoding, the pipeline stages and PNG
+// encoding run as three overlapping stages, each with its own worker threads, connected by
+// bounded queues so at most a fixed number of decoded images are held in memory at once.
+namespace batch
+{
+    // Worker counts and queue depth for run
+    struct Options
+    {
+        int decodeWorkers = 1;
+        int computeWorkers = 1;
+        int encodeWorkers = 1;
+
+        // Images waiting between two stages (per queue)
+        size_t queueDepth = 4;
+
+        // Extension of the output files, which selects their format (see Formats.h)
+        std::string outputExtension = ".png";
+    };
+
+    // Outcome of a batch
+    struct Result
+    {
+        size_t processed = 0;
+        size_t failed = 0;
+    };
+
+    /* Lists the input files of a batch
+    ** @param path: a directory (every image file in it, sorted by name) or a manifest file
+    **              (one path per line, blank lines and lines starting with '#' are skipped)
+    ** @return: input file paths
+    */
+    std::vector<std::string> listInputs(const std::string &path);
+
+    /* Runs a pipeline over every input and writes each result as <output directory>/<input name><output extension>
+    ** Inputs sharing a name get distinct outputs: <name>_<input extension>, plus _<index> if those still collide.
+    ** A file that fails to load, process or save is reported on errors and skipped.
+    ** @param inputs: input file paths
+    ** @param pipeline: stages applied to every image
+    ** @param outputDirectory: directory for the results (created if needed)
+    ** @param options: worker counts and queue depth
+    ** @param errors: stream for per-file error messages
+    ** @return: number of processed and failed files
+    */
+    Result run(const std::vector<std::string> &inputs, const Pipeline &pipeline, const std::string &outputDirectory,
+               const Options &options, std::ostream &errors);
+}
+
+#endif // BATCH_H
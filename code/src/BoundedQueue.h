@@ -0,0 +1,85 @@
+// BoundedQueue.h
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Blocking first-in first-out queue with a fixed capacity, used to hand work between pipeline
+// stages: producers wait while it is full (which caps the memory held between stages) and
+// consumers wait while it is empty, until the queue is closed.
+template <typename T>
+class BoundedQueue
+{
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+public:
+    /* Constructor
+    ** @param capacity: maximum number of queued items (at least 1)
+    */
+    explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    /* Adds an item, waiting while the queue is full
+    ** @param item: item to add (moved into the queue)
+    ** @return: false if the queue was closed (the item is dropped)
+    */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]
+                     { return closed || items.size() < capacity; });
+        if (closed)
+        {
+            return false;
+        }
+
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /* Removes the oldest item, waiting while the queue is empty
+    ** @param item: receives the removed item
+    ** @return: false once the queue is closed and every item has been removed
+    */
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]
+                      { return closed || !items.empty(); });
+        if (items.empty())
+        {
+            return false;
+        }
+
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Closes the queue: pending items can still be popped, further pushes fail and waiting threads wake up
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,17 @@
+// BoundsCheck.h
+
+#ifndef BOUNDS_CHECK_H
+#define BOUNDS_CHECK_H
+
+// Bounds-check policy for the subscript operators of Vector, RowView and Matrix.
+// Checked (throws std::out_of_range) in debug builds, unchecked when NDEBUG is defined.
+// Define BOUNDS_CHECK to 0 or 1 on the command line to override either default.
+#ifndef BOUNDS_CHECK
+#ifdef NDEBUG
+#define BOUNDS_CHECK 0
+#else
+#define BOUNDS_CHECK 1
+#endif
+#endif
+
+#endif // BOUNDS_CHECK_H
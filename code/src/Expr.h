@@ -0,0 +1,237 @@
+// Expr.h
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdexcept>
+#include "Image.h"
+#include "ThreadPool.h"
+
+// Expression templates for fused per-pixel arithmetic.
+// Wrapping operands in lazy() builds an expression instead of an image:
+//
+//     Image out = expr::lazy(a) * 0.5 + expr::lazy(b) * 0.5 - expr::lazy(c);
+//
+// The whole expression is evaluated in one pass over the pixels when it is assigned to an Image
+// or Matrix, and only the destination is allocated. Intermediate values are kept as floats, and
+// the final value of every byte is rounded to nearest (halves up) and clamped to 0-255, so the
+// example gives the same bytes as the eager (a + b) - c.
+//
+// Image.h and Matrix.h only declare the expression constructors and assignments; code that uses
+// them must include this header.
+namespace expr
+{
+    // Base of every expression node (CRTP)
+    template <typename Derived>
+    class Expression
+    {
+    public:
+        const Derived &self() const
+        {
+            return static_cast<const Derived &>(*this);
+        }
+    };
+
+    // Leaf: the bytes of an existing Image or Matrix (referenced, not copied)
+    class Pixels : public Expression<Pixels>
+    {
+    private:
+        const Matrix *matrix;
+        int numChannels;
+
+    public:
+        // Evaluates one row of the leaf
+        struct Row
+        {
+            const uint8_t *bytes;
+            float operator[](int index) const
+            {
+                return bytes[index];
+            }
+        };
+
+        Pixels(const Matrix &matrix, int channels) : matrix(&matrix), numChannels(channels) {}
+
+        int rows() const { return matrix->getRows(); }
+        int cols() const { return matrix->getCols(); }
+        int channels() const { return numChannels; }
+        Row row(int index) const { return Row{matrix->row(index)}; }
+    };
+
+    // Binary node: combines two expressions of the same dimensions byte by byte
+    template <typename Left, typename Right, typename Op>
+    class Binary : public Expression<Binary<Left, Right, Op>>
+    {
+    private:
+        Left left;
+        Right right;
+
+    public:
+        struct Row
+        {
+            typename Left::Row left;
+            typename Right::Row right;
+            float operator[](int index) const
+            {
+                return Op::apply(left[index], right[index]);
+            }
+        };
+
+        Binary(const Left &left, const Right &right) : left(left), right(right)
+        {
+            // Checks to see if the sizes of both operands are compatible
+            if (left.rows() != right.rows() || left.cols() != right.cols() || left.channels() != right.channels())
+            {
+                throw std::invalid_argument("Error (Expr.h_Binary): different operand sizes");
+            }
+        }
+
+        int rows() const { return left.rows(); }
+        int cols() const { return left.cols(); }
+        int channels() const { return left.channels(); }
+        Row row(int index) const { return Row{left.row(index), right.row(index)}; }
+    };
+
+    // Scaled node: multiplies every byte of an expression by a scalar
+    template <typename Operand>
+    class Scaled : public Expression<Scaled<Operand>>
+    {
+    private:
+        Operand operand;
+        float scalar;
+
+    public:
+        struct Row
+        {
+            typename Operand::Row operand;
+            float scalar;
+            float operator[](int index) const
+            {
+                return operand[index] * scalar;
+            }
+        };
+
+        Scaled(const Operand &operand, double scalar) : operand(operand), scalar(static_cast<float>(scalar)) {}
+
+        int rows() const { return operand.rows(); }
+        int cols() const { return operand.cols(); }
+        int channels() const { return operand.channels(); }
+        Row row(int index) const { return Row{operand.row(index), scalar}; }
+    };
+
+    struct AddOp
+    {
+        static float apply(float a, float b) { return a + b; }
+    };
+
+    struct SubtractOp
+    {
+        static float apply(float a, float b) { return a - b; }
+    };
+
+    /* Starts an expression from an image
+    ** @param image: image whose pixels the expression reads (must outlive the expression)
+    */
+    inline Pixels lazy(const Image &image)
+    {
+        return Pixels(image, image.getChannels());
+    }
+
+    /* Starts an expression from a matrix (one byte per element)
+    ** @param matrix: matrix whose bytes the expression reads (must outlive the expression)
+    */
+    inline Pixels lazy(const Matrix &matrix)
+    {
+        return Pixels(matrix, 1);
+    }
+
+    template <typename Left, typename Right>
+    Binary<Left, Right, AddOp> operator+(const Expression<Left> &left, const Expression<Right> &right)
+    {
+        return Binary<Left, Right, AddOp>(left.self(), right.self());
+    }
+
+    template <typename Left, typename Right>
+    Binary<Left, Right, SubtractOp> operator-(const Expression<Left> &left, const Expression<Right> &right)
+    {
+        return Binary<Left, Right, SubtractOp>(left.self(), right.self());
+    }
+
+    template <typename Operand>
+    Scaled<Operand> operator*(const Expression<Operand> &operand, double scalar)
+    {
+        return Scaled<Operand>(operand.self(), scalar);
+    }
+
+    template <typename Operand>
+    Scaled<Operand> operator*(double scalar, const Expression<Operand> &operand)
+    {
+        return Scaled<Operand>(operand.self(), scalar);
+    }
+
+    /* Evaluates an expression into a matrix that already has its dimensions (one fused loop per row)
+    ** The destination may be one of the expression's own operands, since every byte only depends on
+    ** the operand bytes at the same position.
+    ** @param expression: expression to evaluate
+    ** @param destination: matrix with expression.rows() rows and expression.cols() columns
+    */
+    template <typename E>
+    void evaluateInto(const Expression<E> &expression, Matrix &destination)
+    {
+        const E &e = expression.self();
+        int cols = e.cols();
+        ThreadPool::shared().parallelForRows(e.rows(), static_cast<size_t>(cols), [&](int first, int last)
+        {
+            for (int i = first; i < last; ++i)
+            {
+                typename E::Row values = e.row(i);
+                uint8_t *out = destination.row(i);
+                for (int j = 0; j < cols; j++)
+                {
+                    float value = values[j];
+                    out[j] = value <= 0.0f ? 0 : value >= 255.0f ? 255 : static_cast<uint8_t>(value + 0.5f);
+                }
+            } });
+    }
+}
+
+// Image and Matrix construction/assignment from an expression (declared in Image.h and Matrix.h)
+
+template <typename E>
+Matrix::Matrix(const expr::Expression<E> &expression) : Matrix(expression.self().rows(), expression.self().cols())
+{
+    expr::evaluateInto(expression, *this);
+}
+
+template <typename E>
+Matrix &Matrix::operator=(const expr::Expression<E> &expression)
+{
+    const E &e = expression.self();
+    if (numRows != e.rows() || numCols != e.cols())
+    {
+        *this = Matrix(e.rows(), e.cols());
+    }
+    expr::evaluateInto(expression, *this);
+    return *this;
+}
+
+template <typename E>
+Image::Image(const expr::Expression<E> &expression)
+    : Image("", expression.self().channels(), expression.self().cols() / expression.self().channels(), expression.self().rows())
+{
+    expr::evaluateInto(expression, *this);
+}
+
+template <typename E>
+Image &Image::operator=(const expr::Expression<E> &expression)
+{
+    const E &e = expression.self();
+    if (height != e.rows() || width * numChannels != e.cols() || numChannels != e.channels())
+    {
+        *this = Image(filePath, e.channels(), e.cols() / e.channels(), e.rows());
+    }
+    expr::evaluateInto(expression, *this);
+    return *this;
+}
+
+#endif // EXPR_H
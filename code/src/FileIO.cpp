@@ -0,0 +1,265 @@
+// FileIO.cpp
+
+#include "FileIO.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#else
+#include <fstream>
+#endif
+
+namespace
+{
+    std::atomic<fileio::ReadMode> readMode(fileio::ReadMode::stdio);
+
+    // Bytes requested per pread call (large enough that the syscall cost is negligible)
+    const size_t PREAD_CHUNK = 8 * 1024 * 1024;
+
+    // Suffix of the next temporary output file, and names tried before giving up on one
+    std::atomic<unsigned> temporaryCount(0);
+    const int TEMPORARY_ATTEMPTS = 100;
+
+#ifndef _WIN32
+    // Open file descriptor, closed on destruction
+    struct FileDescriptor
+    {
+        int fd;
+
+        explicit FileDescriptor(const std::string &path) : fd(::open(path.c_str(), O_RDONLY))
+        {
+            if (fd < 0)
+            {
+                throw std::runtime_error("Error (FileIO.cpp_open): could not open " + path + ": " + std::strerror(errno));
+            }
+        }
+
+        ~FileDescriptor()
+        {
+            ::close(fd);
+        }
+
+        size_t size(const std::string &path) const
+        {
+            struct stat info;
+            if (::fstat(fd, &info) < 0)
+            {
+                throw std::runtime_error("Error (FileIO.cpp_stat): could not stat " + path + ": " + std::strerror(errno));
+            }
+            return static_cast<size_t>(info.st_size);
+        }
+    };
+#else
+    // Reads a whole file with one stream read (Windows has neither mmap nor pread)
+    void readFile(const std::string &path, std::vector<uint8_t> &buffer)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Error (FileIO.cpp_open): could not open " + path);
+        }
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        if (!file)
+        {
+            throw std::runtime_error("Error (FileIO.cpp_read): could not read " + path);
+        }
+    }
+#endif
+}
+
+void fileio::setReadMode(ReadMode mode)
+{
+    readMode = mode;
+}
+
+fileio::ReadMode fileio::getReadMode()
+{
+    return readMode;
+}
+
+fileio::ReadMode fileio::parseReadMode(const std::string &name)
+{
+    if (name == "stdio")
+    {
+        return ReadMode::stdio;
+    }
+    if (name == "mmap")
+    {
+        return ReadMode::mmap;
+    }
+    if (name == "pread")
+    {
+        return ReadMode::pread;
+    }
+    throw std::invalid_argument("Error (FileIO.cpp_parseReadMode): unknown read mode " + name);
+}
+
+fileio::MappedFile::MappedFile(const std::string &path) : data(nullptr), size(0)
+{
+#ifndef _WIN32
+    FileDescriptor file(path);
+    size = file.size(path);
+    if (size == 0)
+    {
+        return;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file.fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Error (FileIO.cpp_MappedFile): could not map " + path + ": " + std::strerror(errno));
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<uint8_t *>(mapping);
+#else
+    readFile(path, fallback);
+    data = fallback.data();
+    size = fallback.size();
+#endif
+}
+
+fileio::MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (data != nullptr)
+    {
+        ::munmap(data, size);
+    }
+#endif
+}
+
+uint8_t *fileio::MappedFile::getData() const
+{
+    return data;
+}
+
+size_t fileio::MappedFile::getSize() const
+{
+    return size;
+}
+
+uint8_t *fileio::MappedFile::release()
+{
+#ifndef _WIN32
+    uint8_t *mapping = data;
+#else
+    // The fallback buffer belongs to this object, so the caller gets a copy it can free with unmap
+    uint8_t *mapping = size > 0 ? new uint8_t[size] : nullptr;
+    std::copy(fallback.begin(), fallback.end(), mapping);
+    fallback.clear();
+#endif
+    data = nullptr;
+    return mapping;
+}
+
+void fileio::MappedFile::unmap(uint8_t *data, size_t size)
+{
+#ifndef _WIN32
+    if (data != nullptr)
+    {
+        ::munmap(data, size);
+    }
+#else
+    delete[] data;
+#endif
+}
+
+const std::vector<uint8_t> &fileio::readAll(const std::string &path)
+{
+    // Grows to the largest file read on this thread and is never shrunk
+    thread_local std::vector<uint8_t> buffer;
+
+#ifndef _WIN32
+    FileDescriptor file(path);
+    size_t size = file.size(path);
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    buffer.resize(size);
+
+    size_t done = 0;
+    while (done < size)
+    {
+        size_t chunk = size - done < PREAD_CHUNK ? size - done : PREAD_CHUNK;
+        ssize_t n = ::pread(file.fd, buffer.data() + done, chunk, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            throw std::runtime_error("Error (FileIO.cpp_readAll): could not read " + path);
+        }
+        done += static_cast<size_t>(n);
+    }
+#else
+    readFile(path, buffer);
+#endif
+
+    return buffer;
+}
+
+fileio::ReplacementFile::ReplacementFile(const std::string &path) : path(path), file(nullptr)
+{
+    // Exclusive creation ("x"), so concurrent writers (threads or processes) never share a name
+    for (int i = 0; !file && i < TEMPORARY_ATTEMPTS; i++)
+    {
+        temporaryPath = path + "." + std::to_string(temporaryCount++) + ".tmp";
+        file = std::fopen(temporaryPath.c_str(), "wbx");
+        if (!file && errno != EEXIST)
+        {
+            break;
+        }
+    }
+}
+
+fileio::ReplacementFile::~ReplacementFile()
+{
+    if (file)
+    {
+        std::fclose(file);
+        std::remove(temporaryPath.c_str());
+    }
+}
+
+std::FILE *fileio::ReplacementFile::get() const
+{
+    return file;
+}
+
+bool fileio::ReplacementFile::commit()
+{
+    if (!file)
+    {
+        return false;
+    }
+    bool written = !std::ferror(file);
+    written = std::fclose(file) == 0 && written;
+    file = nullptr;
+
+    // Replaces an existing target too (std::rename fails on Windows when the target exists)
+    std::error_code error;
+    if (written)
+    {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (!written || error)
+    {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
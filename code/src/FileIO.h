@@ -0,0 +1,119 @@
+// FileIO.h
+
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Ways of getting an input file's bytes to a decoder, chosen for the whole process with
+// setReadMode (--io on the command line):
+//   stdio  stb_image reads the file itself through buffered stdio (the default)
+//   mmap   the file is mapped private and writable (copy-on-write, so writes never reach the file)
+//          with sequential read-ahead and decoded from memory
+//   pread  the file is read with a few large pread calls into a per-thread buffer that is
+//          reused across files
+namespace fileio
+{
+    enum class ReadMode
+    {
+        stdio,
+        mmap,
+        pread
+    };
+
+    /* Sets the read mode for every following load
+    ** @param mode: read mode
+    */
+    void setReadMode(ReadMode mode);
+
+    // Current read mode
+    ReadMode getReadMode();
+
+    /* Parses a read mode name (stdio, mmap or pread)
+    ** @param name: mode name
+    ** @return: read mode (throws std::invalid_argument for an unknown name)
+    */
+    ReadMode parseReadMode(const std::string &name);
+
+    // Private mapping of a whole file, unmapped on destruction. Pages are shared with the page cache
+    // until written, when the writer gets its own copy (the file itself is never modified).
+    // On Windows the file is read into memory instead.
+    class MappedFile
+    {
+    private:
+        uint8_t *data;
+        size_t size;
+        std::vector<uint8_t> fallback;
+
+    public:
+        /* Constructor (maps the file and advises the kernel that it will be read sequentially)
+        ** @param path: file to map (throws std::runtime_error if it cannot be opened or mapped)
+        */
+        explicit MappedFile(const std::string &path);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // First byte of the file
+        uint8_t *getData() const;
+
+        // File size in bytes
+        size_t getSize() const;
+
+        /* Hands the mapping over to the caller (the MappedFile is left empty)
+        ** @return: first byte of the file, to be released with unmap(data, getSize())
+        */
+        uint8_t *release();
+
+        /* Releases a mapping handed over by release
+        ** @param data: pointer returned by release
+        ** @param size: file size in bytes
+        */
+        static void unmap(uint8_t *data, size_t size);
+    };
+
+    /* Reads a whole file with large pread calls into the calling thread's reusable buffer
+    ** @param path: file to read (throws std::runtime_error if it cannot be read)
+    ** @return: buffer holding the file (valid until the thread's next readAll)
+    */
+    const std::vector<uint8_t> &readAll(const std::string &path);
+
+    // Output file written under a temporary name in the target's directory and renamed over the
+    // target by commit, so an existing target is replaced in one step instead of being truncated
+    // while it may still be read (an image saved over its own input can hold a MappedFile of it).
+    // The temporary file is removed if commit is not reached or fails.
+    class ReplacementFile
+    {
+    private:
+        std::string path;
+        std::string temporaryPath;
+        std::FILE *file;
+
+    public:
+        /* Constructor (creates the temporary file)
+        ** @param path: file to replace (or create)
+        */
+        explicit ReplacementFile(const std::string &path);
+
+        ~ReplacementFile();
+
+        ReplacementFile(const ReplacementFile &) = delete;
+        ReplacementFile &operator=(const ReplacementFile &) = delete;
+
+        // Temporary file to write to (nullptr if it could not be created)
+        std::FILE *get() const;
+
+        /* Closes the temporary file and renames it over the target
+        ** @return: whether every write, the close and the rename succeeded
+        */
+        bool commit();
+    };
+}
+
+#endif // FILE_IO_H
@@ -0,0 +1,322 @@
+// Formats.cpp
+
+#include "Formats.h"
+#include "FileIO.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // Magic number at the start of a raw file
+    const char RAW_MAGIC[4] = {'R', 'A', 'W', 'I'};
+    const size_t RAW_HEADER_SIZE = 16;
+
+    // Walks through the ASCII header of a Netpbm file
+    class HeaderReader
+    {
+    private:
+        const uint8_t *bytes;
+        size_t size;
+        size_t pos;
+        const std::string &path;
+
+    public:
+        HeaderReader(const uint8_t *bytes, size_t size, size_t pos, const std::string &path)
+            : bytes(bytes), size(size), pos(pos), path(path) {}
+
+        [[noreturn]] void fail(const std::string &message) const
+        {
+            throw std::runtime_error("Error (Formats.cpp_parseHeader): " + path + ": " + message);
+        }
+
+        // Skips whitespace and '#' comments (which run to the end of the line)
+        void skipSpace()
+        {
+            while (pos < size)
+            {
+                if (bytes[pos] == '#')
+                {
+                    while (pos < size && bytes[pos] != '\n')
+                    {
+                        pos++;
+                    }
+                }
+                else if (std::isspace(bytes[pos]))
+                {
+                    pos++;
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        // Next run of non-whitespace characters
+        std::string token()
+        {
+            skipSpace();
+            size_t start = pos;
+            while (pos < size && !std::isspace(bytes[pos]))
+            {
+                pos++;
+            }
+            if (start == pos)
+            {
+                fail("truncated header");
+            }
+            return std::string(reinterpret_cast<const char *>(bytes) + start, pos - start);
+        }
+
+        // Next token as a positive integer
+        int number()
+        {
+            std::string text = token();
+            if (text.size() > 9 || !std::all_of(text.begin(), text.end(), [](char c)
+                                                { return std::isdigit(static_cast<unsigned char>(c)); }))
+            {
+                fail("invalid number " + text);
+            }
+            int value = std::stoi(text);
+            if (value <= 0)
+            {
+                fail("invalid number " + text);
+            }
+            return value;
+        }
+
+        // Skips the single whitespace character that ends the header
+        size_t endOfHeader()
+        {
+            if (pos >= size || !std::isspace(bytes[pos]))
+            {
+                fail("truncated header");
+            }
+            return pos + 1;
+        }
+    };
+
+    // Reads a little-endian 32-bit integer
+    uint32_t readLittleEndian(const uint8_t *bytes)
+    {
+        return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+               static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+    void writeLittleEndian(uint8_t *bytes, uint32_t value)
+    {
+        bytes[0] = static_cast<uint8_t>(value);
+        bytes[1] = static_cast<uint8_t>(value >> 8);
+        bytes[2] = static_cast<uint8_t>(value >> 16);
+        bytes[3] = static_cast<uint8_t>(value >> 24);
+    }
+}
+
+formats::Format formats::fromPath(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return Format::stb;
+    }
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    if (extension == "ppm")
+    {
+        return Format::ppm;
+    }
+    if (extension == "pgm")
+    {
+        return Format::pgm;
+    }
+    if (extension == "pam")
+    {
+        return Format::pam;
+    }
+    if (extension == "raw")
+    {
+        return Format::raw;
+    }
+    if (extension == "qoi")
+    {
+        return Format::qoi;
+    }
+    return Format::stb;
+}
+
+formats::Header formats::parseHeader(Format format, const uint8_t *bytes, size_t size, const std::string &path)
+{
+    Header header;
+    HeaderReader reader(bytes, size, 2, path);
+
+    if (format == Format::raw)
+    {
+        if (size < RAW_HEADER_SIZE || std::memcmp(bytes, RAW_MAGIC, sizeof(RAW_MAGIC)) != 0)
+        {
+            reader.fail("not a raw image");
+        }
+        uint32_t width = readLittleEndian(bytes + 4);
+        uint32_t height = readLittleEndian(bytes + 8);
+        uint32_t channels = readLittleEndian(bytes + 12);
+        if (width == 0 || height == 0 || channels == 0 || channels > 4 || width > 0x7fffffffu / channels || height > 0x7fffffffu)
+        {
+            reader.fail("invalid dimensions");
+        }
+        header.width = static_cast<int>(width);
+        header.height = static_cast<int>(height);
+        header.channels = static_cast<int>(channels);
+        header.offset = RAW_HEADER_SIZE;
+    }
+    else if (format == Format::ppm || format == Format::pgm)
+    {
+        const char *magic = format == Format::ppm ? "P6" : "P5";
+        if (size < 2 || bytes[0] != magic[0] || bytes[1] != magic[1])
+        {
+            reader.fail(std::string("expected a binary ") + (format == Format::ppm ? "PPM (P6)" : "PGM (P5)"));
+        }
+        header.width = reader.number();
+        header.height = reader.number();
+        if (reader.number() != 255)
+        {
+            reader.fail("only 8-bit samples (maxval 255) are supported");
+        }
+        header.channels = format == Format::ppm ? 3 : 1;
+        header.offset = reader.endOfHeader();
+    }
+    else if (format == Format::pam)
+    {
+        if (size < 2 || bytes[0] != 'P' || bytes[1] != '7')
+        {
+            reader.fail("expected a PAM (P7) file");
+        }
+
+        header.width = header.height = header.channels = 0;
+        int maxValue = 0;
+        for (std::string key = reader.token(); key != "ENDHDR"; key = reader.token())
+        {
+            if (key == "WIDTH")
+            {
+                header.width = reader.number();
+            }
+            else if (key == "HEIGHT")
+            {
+                header.height = reader.number();
+            }
+            else if (key == "DEPTH")
+            {
+                header.channels = reader.number();
+            }
+            else if (key == "MAXVAL")
+            {
+                maxValue = reader.number();
+            }
+            else if (key == "TUPLTYPE")
+            {
+                // The tuple type only names the channels, the depth already gives their count
+                reader.token();
+            }
+            else
+            {
+                reader.fail("unknown header field " + key);
+            }
+        }
+        if (header.width == 0 || header.height == 0 || header.channels < 1 || header.channels > 4)
+        {
+            reader.fail("missing or invalid dimensions");
+        }
+        if (maxValue != 255)
+        {
+            reader.fail("only 8-bit samples (maxval 255) are supported");
+        }
+        header.offset = reader.endOfHeader();
+    }
+    else
+    {
+        throw std::invalid_argument("Error (Formats.cpp_parseHeader): not an uncompressed format");
+    }
+
+    // Checks that a row fits a Matrix and that the file holds every pixel
+    if (static_cast<size_t>(header.width) * header.channels > 0x7fffffffu)
+    {
+        reader.fail("invalid dimensions");
+    }
+    size_t pixelBytes = static_cast<size_t>(header.width) * header.height * header.channels;
+    if (header.offset > size || size - header.offset < pixelBytes)
+    {
+        reader.fail("truncated pixel data");
+    }
+    return header;
+}
+
+void formats::write(const std::string &path, Format format, const uint8_t *pixels, int width, int height, int channels, size_t stride)
+{
+    // Builds the header
+    std::string header;
+    if (format == Format::raw)
+    {
+        uint8_t bytes[RAW_HEADER_SIZE];
+        std::memcpy(bytes, RAW_MAGIC, sizeof(RAW_MAGIC));
+        writeLittleEndian(bytes + 4, static_cast<uint32_t>(width));
+        writeLittleEndian(bytes + 8, static_cast<uint32_t>(height));
+        writeLittleEndian(bytes + 12, static_cast<uint32_t>(channels));
+        header.assign(reinterpret_cast<const char *>(bytes), RAW_HEADER_SIZE);
+    }
+    else if (format == Format::ppm || format == Format::pgm)
+    {
+        int expected = format == Format::ppm ? 3 : 1;
+        if (channels != expected)
+        {
+            throw std::invalid_argument("Error (Formats.cpp_write): " + path + " needs " + std::to_string(expected) +
+                                        " channel(s), the image has " + std::to_string(channels) + " (use .pam or .raw)");
+        }
+        header = std::string(format == Format::ppm ? "P6" : "P5") + "\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    }
+    else if (format == Format::pam)
+    {
+        const char *tupleTypes[] = {"GRAYSCALE", "GRAYSCALE_ALPHA", "RGB", "RGB_ALPHA"};
+        if (channels < 1 || channels > 4)
+        {
+            throw std::invalid_argument("Error (Formats.cpp_write): PAM supports 1 to 4 channels");
+        }
+        header = "P7\nWIDTH " + std::to_string(width) + "\nHEIGHT " + std::to_string(height) + "\nDEPTH " + std::to_string(channels) +
+                 "\nMAXVAL 255\nTUPLTYPE " + tupleTypes[channels - 1] + "\nENDHDR\n";
+    }
+    else
+    {
+        throw std::invalid_argument("Error (Formats.cpp_write): not an uncompressed format");
+    }
+
+    // Written under a temporary name and renamed over the target: the pixels may be mapped from the
+    // target itself (an image loaded with --io mmap and saved over its input), which truncating it
+    // in place would pull out from under the writes below
+    fileio::ReplacementFile file(path);
+    if (!file.get())
+    {
+        throw std::runtime_error("Error (Formats.cpp_write): could not write " + path);
+    }
+
+    // Rows are written straight from the pixel buffer (in one call when they are tightly packed)
+    size_t rowBytes = static_cast<size_t>(width) * channels;
+    bool written = std::fwrite(header.data(), 1, header.size(), file.get()) == header.size();
+    if (stride == rowBytes)
+    {
+        written = written && std::fwrite(pixels, 1, rowBytes * height, file.get()) == rowBytes * height;
+    }
+    else
+    {
+        for (int i = 0; written && i < height; i++)
+        {
+            written = std::fwrite(pixels + i * stride, 1, rowBytes, file.get()) == rowBytes;
+        }
+    }
+    if (!written || !file.commit())
+    {
+        throw std::runtime_error("Error (Formats.cpp_write): could not write " + path);
+    }
+}
@@ -0,0 +1,62 @@
+// Formats.h
+
+#ifndef FORMATS_H
+#define FORMATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Uncompressed image formats, used as a cheap interchange format between processing steps.
+// They are chosen by file extension, as is QOI (.qoi, see Qoi.h); everything else is decoded by
+// stb_image and saved as PNG.
+//   .ppm  binary PPM (P6), 3 channels        .pgm  binary PGM (P5), 1 channel
+//   .pam  PAM (P7), 1 to 4 channels           .raw  16-byte header, then tightly packed pixels
+// Samples are 8-bit (MAXVAL 255). The raw header is the magic "RAWI" followed by width,
+// height and channels as little-endian 32-bit integers.
+namespace formats
+{
+    enum class Format
+    {
+        stb,
+        ppm,
+        pgm,
+        pam,
+        raw,
+        qoi
+    };
+
+    /* Format of a file, from its extension (case-insensitive)
+    ** @param path: file path
+    ** @return: format (stb for any extension not listed above)
+    */
+    Format fromPath(const std::string &path);
+
+    // Image dimensions and the position of the first pixel in the file
+    struct Header
+    {
+        int width;
+        int height;
+        int channels;
+        size_t offset;
+    };
+
+    /* Reads the header of an uncompressed file and checks that the pixels fit in it
+    ** @param format: ppm, pgm, pam or raw
+    ** @param bytes, size: file contents
+    ** @param path: file path (for error messages)
+    ** @return: header (throws std::runtime_error for a malformed or truncated file)
+    */
+    Header parseHeader(Format format, const uint8_t *bytes, size_t size, const std::string &path);
+
+    /* Writes an image in an uncompressed format
+    ** @param path: output file
+    ** @param format: ppm, pgm, pam or raw (ppm needs 3 channels, pgm 1, otherwise throws std::invalid_argument)
+    ** @param pixels: first pixel of the image
+    ** @param width, height, channels: image dimensions
+    ** @param stride: bytes between rows of pixels
+    */
+    void write(const std::string &path, Format format, const uint8_t *pixels, int width, int height, int channels, size_t stride);
+}
+
+#endif // FORMATS_H
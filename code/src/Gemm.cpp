@@ -0,0 +1,261 @@
+// Gemm.cpp
+//
+// Blocked GEMM in the usual packed-panel layout:
+//   - B (one channel) is packed once into panels of NR columns, with consecutive k values
+//     paired up as 16-bit integers so a single multiply-add (pmaddwd) handles two k steps;
+//   - A is packed per (MC x KC) block into panels of MR rows in the same paired layout;
+//   - an MR x NR micro-kernel keeps its tile of 32-bit sums in registers across a KC block,
+//     and adds it into an MC x NC accumulator block that is normalized to 0-255 at the end.
+// The output is split into (channel, MC rows, NC columns) tiles that the shared thread pool
+// computes in parallel; NC is sized so one KC x NC panel of packed B stays in L2.
+
+#include "Gemm.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_X86 1
+#include <immintrin.h>
+#else
+#define GEMM_X86 0
+#endif
+
+namespace
+{
+    // Micro-kernel tile (rows x columns) and cache block sizes (KC must be even)
+    const int MR = 4;
+    const int NR = 8;
+    const int MC = 64;
+    const int KC = 256;
+    const int NC = 512;
+
+    int roundUp(int value, int multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    // Reads a packed (k, k + 1) pair of 16-bit values as one 32-bit lane
+    inline int32_t loadPair(const int16_t *pair)
+    {
+        int32_t value;
+        std::memcpy(&value, pair, sizeof(value));
+        return value;
+    }
+
+    // Micro-kernel: acc[MR x NR] += aPanel[MR x 2*pairs] * bPanel[2*pairs x NR]
+    typedef void (*MicroKernel)(const int16_t *aPanel, const int16_t *bPanel, int pairs, uint32_t *acc, int accStride);
+
+    void microKernelScalar(const int16_t *aPanel, const int16_t *bPanel, int pairs, uint32_t *acc, int accStride)
+    {
+        uint32_t tile[MR][NR] = {};
+        for (int p = 0; p < pairs; p++)
+        {
+            const int16_t *a = aPanel + p * MR * 2;
+            const int16_t *b = bPanel + p * NR * 2;
+            for (int r = 0; r < MR; r++)
+            {
+                for (int col = 0; col < NR; col++)
+                {
+                    tile[r][col] += a[r * 2] * b[col * 2] + a[r * 2 + 1] * b[col * 2 + 1];
+                }
+            }
+        }
+        for (int r = 0; r < MR; r++)
+        {
+            for (int col = 0; col < NR; col++)
+            {
+                acc[r * accStride + col] += tile[r][col];
+            }
+        }
+    }
+
+#if GEMM_X86
+    __attribute__((target("sse2"))) void microKernelSse2(const int16_t *aPanel, const int16_t *bPanel, int pairs, uint32_t *acc, int accStride)
+    {
+        __m128i tile[MR][2];
+        for (int r = 0; r < MR; r++)
+        {
+            tile[r][0] = _mm_setzero_si128();
+            tile[r][1] = _mm_setzero_si128();
+        }
+        for (int p = 0; p < pairs; p++)
+        {
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bPanel + p * NR * 2));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bPanel + p * NR * 2 + 8));
+            const int16_t *a = aPanel + p * MR * 2;
+            for (int r = 0; r < MR; r++)
+            {
+                __m128i pair = _mm_set1_epi32(loadPair(a + r * 2));
+                tile[r][0] = _mm_add_epi32(tile[r][0], _mm_madd_epi16(pair, b0));
+                tile[r][1] = _mm_add_epi32(tile[r][1], _mm_madd_epi16(pair, b1));
+            }
+        }
+        for (int r = 0; r < MR; r++)
+        {
+            __m128i *out = reinterpret_cast<__m128i *>(acc + r * accStride);
+            _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), tile[r][0]));
+            _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), tile[r][1]));
+        }
+    }
+
+    __attribute__((target("avx2"))) void microKernelAvx2(const int16_t *aPanel, const int16_t *bPanel, int pairs, uint32_t *acc, int accStride)
+    {
+        __m256i tile[MR];
+        for (int r = 0; r < MR; r++)
+        {
+            tile[r] = _mm256_setzero_si256();
+        }
+        for (int p = 0; p < pairs; p++)
+        {
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bPanel + p * NR * 2));
+            const int16_t *a = aPanel + p * MR * 2;
+            for (int r = 0; r < MR; r++)
+            {
+                tile[r] = _mm256_add_epi32(tile[r], _mm256_madd_epi16(_mm256_set1_epi32(loadPair(a + r * 2)), b));
+            }
+        }
+        for (int r = 0; r < MR; r++)
+        {
+            __m256i *out = reinterpret_cast<__m256i *>(acc + r * accStride);
+            _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), tile[r]));
+        }
+    }
+#endif
+
+    // Picks the micro-kernel for this CPU once (AVX-512 would not widen the 4 x 8 tile, so AVX2 is the top)
+    MicroKernel selectMicroKernel()
+    {
+#if GEMM_X86
+        if (kernels::isaEnabled("avx2"))
+        {
+            return microKernelAvx2;
+        }
+        if (kernels::isaEnabled("sse2"))
+        {
+            return microKernelSse2;
+        }
+#endif
+        return microKernelScalar;
+    }
+
+    MicroKernel microKernel()
+    {
+        static const MicroKernel selected = selectMicroKernel();
+        return selected;
+    }
+
+    // Packs one channel of B (k x n) into NR-column panels of k pairs, zero padded
+    void packB(const uint8_t *b, size_t bStride, int n, int k, int channels, int channel, std::vector<int16_t> &packed)
+    {
+        int pairs = roundUp(k, 2) / 2;
+        int panels = roundUp(n, NR) / NR;
+        packed.assign(static_cast<size_t>(panels) * pairs * NR * 2, 0);
+        for (int panel = 0; panel < panels; panel++)
+        {
+            int16_t *out = packed.data() + static_cast<size_t>(panel) * pairs * NR * 2;
+            int columns = n - panel * NR < NR ? n - panel * NR : NR;
+            for (int kk = 0; kk < k; kk++)
+            {
+                const uint8_t *src = b + kk * bStride + (static_cast<size_t>(panel) * NR * channels + channel);
+                int16_t *dst = out + (kk / 2) * NR * 2 + (kk % 2);
+                for (int col = 0; col < columns; col++)
+                {
+                    dst[col * 2] = src[col * channels];
+                }
+            }
+        }
+    }
+
+    // Packs rows [row0, row0 + rows) and k values [k0, k0 + depth) of one channel of A into MR-row panels
+    void packA(const uint8_t *a, size_t aStride, int row0, int rows, int k0, int depth, int channels, int channel, std::vector<int16_t> &packed)
+    {
+        int pairs = roundUp(depth, 2) / 2;
+        int panels = roundUp(rows, MR) / MR;
+        packed.assign(static_cast<size_t>(panels) * pairs * MR * 2, 0);
+        for (int r = 0; r < rows; r++)
+        {
+            const uint8_t *src = a + (row0 + r) * aStride + (static_cast<size_t>(k0) * channels + channel);
+            int16_t *dst = packed.data() + static_cast<size_t>(r / MR) * pairs * MR * 2 + (r % MR) * 2;
+            for (int kk = 0; kk < depth; kk++)
+            {
+                dst[(kk / 2) * MR * 2 + (kk % 2)] = src[kk * channels];
+            }
+        }
+    }
+}
+
+namespace gemm
+{
+    void multiply(const uint8_t *a, size_t aStride, const uint8_t *b, size_t bStride, uint8_t *c, size_t cStride,
+                  int m, int n, int k, int channels)
+    {
+        // Checks for dimensions the 32-bit accumulators cannot hold
+        if (k > MAX_INNER)
+        {
+            throw std::invalid_argument("Error (Gemm.cpp_multiply): inner dimension too large");
+        }
+        if (m <= 0 || n <= 0 || k <= 0)
+        {
+            return;
+        }
+
+        MicroKernel kernel = microKernel();
+        ThreadPool &pool = ThreadPool::shared();
+        int pairs = roundUp(k, 2) / 2;
+        uint64_t divisor = 255ull * k;
+
+        // Packs B once per channel, shared (read-only) by every tile
+        std::vector<std::vector<int16_t>> packedB(channels);
+        pool.parallelFor(channels, [&](int channel)
+                         { packB(b, bStride, n, k, channels, channel, packedB[channel]); });
+
+        int rowBlocks = (m + MC - 1) / MC;
+        int columnBlocks = (n + NC - 1) / NC;
+        pool.parallelFor(channels * rowBlocks * columnBlocks, [&](int tile)
+                         {
+            int channel = tile / (rowBlocks * columnBlocks);
+            int row0 = tile / columnBlocks % rowBlocks * MC;
+            int column0 = tile % columnBlocks * NC;
+            int rows = m - row0 < MC ? m - row0 : MC;
+            int columns = n - column0 < NC ? n - column0 : NC;
+
+            // Scratch buffers are kept per thread and reused across tiles and calls
+            thread_local std::vector<int16_t> packedA;
+            thread_local std::vector<uint32_t> acc;
+            const int accStride = NC;
+            acc.assign(static_cast<size_t>(roundUp(MC, MR)) * accStride, 0);
+
+            // Accumulates the whole inner dimension one KC block at a time
+            for (int k0 = 0; k0 < k; k0 += KC)
+            {
+                int depth = k - k0 < KC ? k - k0 : KC;
+                int depthPairs = roundUp(depth, 2) / 2;
+                packA(a, aStride, row0, rows, k0, depth, channels, channel, packedA);
+
+                for (int panelB = 0; panelB * NR < columns; panelB++)
+                {
+                    const int16_t *bPanel = packedB[channel].data() + (static_cast<size_t>(column0 / NR + panelB) * pairs + k0 / 2) * NR * 2;
+                    for (int panelA = 0; panelA * MR < rows; panelA++)
+                    {
+                        const int16_t *aPanel = packedA.data() + static_cast<size_t>(panelA) * depthPairs * MR * 2;
+                        kernel(aPanel, bPanel, depthPairs, acc.data() + panelA * MR * accStride + panelB * NR, accStride);
+                    }
+                }
+            }
+
+            // Normalizes the sums back to 0-255 (rounded to nearest)
+            for (int r = 0; r < rows; r++)
+            {
+                const uint32_t *sums = acc.data() + r * accStride;
+                uint8_t *out = c + (row0 + r) * cStride + static_cast<size_t>(column0) * channels + channel;
+                for (int col = 0; col < columns; col++)
+                {
+                    out[col * channels] = static_cast<uint8_t>((sums[col] + divisor / 2) / divisor);
+                }
+            } });
+    }
+}
@@ -0,0 +1,31 @@
+// Gemm.h
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Matrix multiplication of 8-bit pixel data with 32-bit accumulators
+namespace gemm
+{
+    // Largest inner dimension whose sums of products still fit in a 32-bit accumulator
+    const int MAX_INNER = 66051;
+
+    /* Multiplies two interleaved multi-channel matrices, channel by channel:
+    **     c[i][j][ch] = round(sum_k a[i][k][ch] * b[k][j][ch] / (255 * k))
+    ** i.e. the mean of the k products, rescaled from 0-255*255 back to 0-255.
+    ** @param a: first byte of the (m x k) left matrix, channels interleaved
+    ** @param aStride: bytes between rows of a
+    ** @param b: first byte of the (k x n) right matrix, channels interleaved
+    ** @param bStride: bytes between rows of b
+    ** @param c: first byte of the (m x n) result, channels interleaved
+    ** @param cStride: bytes between rows of c
+    ** @param m, n, k: matrix dimensions (in pixels, k <= MAX_INNER)
+    ** @param channels: number of interleaved channels per pixel
+    */
+    void multiply(const uint8_t *a, size_t aStride, const uint8_t *b, size_t bStride, uint8_t *c, size_t cStride,
+                  int m, int n, int k, int channels);
+}
+
+#endif // GEMM_H
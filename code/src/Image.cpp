@@ -1,25 +1,109 @@
 // Image.cpp
 
 #include "Image.h"
+#include "FileIO.h"
+#include "Formats.h"
+#include "Gemm.h"
+#include "Kernels.h"
+#include "Png.h"
+#include "Qoi.h"
+#include "ResizeContext.h"
+#include "StageTimer.h"
+#include "ThreadPool.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
-#include "stb_image_resize.h"
 #include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <memory>
 #include <stdexcept>
-#include <vector>
+#include <utility>
+
+namespace
+{
+    // Decodes an image file, getting its bytes the way the current read mode asks for (see FileIO.h)
+    uint8_t *decodeFile(const std::string &filePath, int &width, int &height, int &channels)
+    {
+        // stb_image takes in-memory lengths as int
+        auto length = [&](size_t size)
+        {
+            if (size > static_cast<size_t>(INT_MAX))
+            {
+                throw std::runtime_error("Error (Image.cpp_Image): " + filePath + " is too large to decode");
+            }
+            return static_cast<int>(size);
+        };
+
+        switch (fileio::getReadMode())
+        {
+        case fileio::ReadMode::mmap:
+        {
+            fileio::MappedFile file(filePath);
+            return stbi_load_from_memory(file.getData(), length(file.getSize()), &width, &height, &channels, 0);
+        }
+        case fileio::ReadMode::pread:
+        {
+            const std::vector<uint8_t> &bytes = fileio::readAll(filePath);
+            return stbi_load_from_memory(bytes.data(), length(bytes.size()), &width, &height, &channels, 0);
+        }
+        default:
+            return stbi_load(filePath.c_str(), &width, &height, &channels, 0);
+        }
+    }
+}
 
 // Default constructor
 Image::Image() : Matrix(), filePath(""), numChannels(0), width(0), height(0) {}
 
 Image::Image(const std::string &filePath) : Matrix()
 {
+    // Uncompressed formats (see Formats.h) are mapped and their pixels used in place, without a copy
+    formats::Format format = formats::fromPath(filePath);
+    if (format == formats::Format::qoi)
+    {
+        // QOI is decoded straight from the mapped file into a buffer the Matrix takes over
+        StageTimer timer("load.decode");
+        fileio::MappedFile file(filePath);
+        qoi::Header header = qoi::readHeader(file.getData(), file.getSize());
+
+        this->filePath = filePath;
+        this->numChannels = header.channels;
+        this->width = header.width;
+        this->height = header.height;
+
+        std::unique_ptr<uint8_t[]> pixels(new uint8_t[static_cast<size_t>(width) * numChannels * height]);
+        qoi::decode(file.getData(), file.getSize(), pixels.get(), static_cast<size_t>(width) * numChannels);
+        adopt(pixels.release(), height, width * numChannels, width * numChannels, [](uint8_t *buffer)
+              { delete[] buffer; });
+        return;
+    }
+    if (format != formats::Format::stb)
+    {
+        StageTimer timer("load.map");
+        fileio::MappedFile file(filePath);
+        formats::Header header = formats::parseHeader(format, file.getData(), file.getSize(), filePath);
+
+        this->filePath = filePath;
+        this->numChannels = header.channels;
+        this->width = header.width;
+        this->height = header.height;
+
+        // The mapping is private, so in-place operations write to copies of the pages they touch, never to the file
+        size_t size = file.getSize();
+        uint8_t *mapping = file.release();
+        adopt(mapping + header.offset, height, width * numChannels, width * numChannels, [mapping, size](uint8_t *)
+              { fileio::MappedFile::unmap(mapping, size); });
+        return;
+    }
+
     // Load the image using stb_image
     int width, height, channels;
-    uint8_t *imageData = stbi_load(filePath.c_str(), &width, &height, &channels, 0);
-
-    // Initialize the Matrix base class with the image data
-    // (You need to implement a constructor or a function in the Matrix class
-    //  that allows you to initialize it with image data)
+    StageTimer timer("load.decode");
+    uint8_t *imageData = decodeFile(filePath, width, height, channels);
+    if (imageData == nullptr)
+    {
+        throw std::runtime_error("Error (Image.cpp_Image): could not load " + filePath);
+    }
 
     // Set the Image properties
     this->filePath = filePath;
@@ -27,23 +111,10 @@ Image::Image(const std::string &filePath) : Matrix()
     this->width = width;
     this->height = height;
 
-    // Use the assignment operator to copy the data from the image to the Matrix
-    Matrix::operator=(Matrix(this->height, this->width * this->numChannels));
-
-    for (int i = 0; i < this->height; ++i)
-    {
-        for (int j = 0; j < this->width; ++j)
-        {
-            for (int k = 0; k < this->numChannels; ++k)
-            {
-                // Copy the pixel data from the image to the Matrix
-                data[i][j * this->numChannels + k] = imageData[(i * this->width + j) * this->numChannels + k];
-            }
-        }
-    }
-
-    // Free the loaded image data
-    stbi_image_free(imageData);
+    // The Matrix takes ownership of the decoded buffer (rows are tightly packed),
+    // and frees it through stb_image once it is no longer needed
+    adopt(imageData, height, width * channels, width * channels, [](uint8_t *buffer)
+          { stbi_image_free(buffer); });
 }
 
 // Constructor with file path, channels, width, and height (changed the matrix width to width * numChannels)
@@ -55,17 +126,7 @@ Image::Image(const std::string &filePath, int numChannels, int width, int height
 Image::Image(const Image &other)
     : Matrix(other), filePath(other.filePath), numChannels(other.numChannels), width(other.width), height(other.height) // Initialize the Matrix base class with the image data
 {
-    for (int i = 0; i < height; ++i)
-    {
-        for (int j = 0; j < width; ++j)
-        {
-            for (int k = 0; k < numChannels; ++k)
-            {
-                // Copy the pixel data from the other image to this object's matrix data
-                data[i][j * numChannels + k] = other.data[i][j * numChannels + k];
-            }
-        }
-    }
+    // The Matrix copy constructor already copied the pixel data
 }
 
 // Assignment operator
@@ -86,6 +147,37 @@ Image &Image::operator=(const Image &other)
     return *this;
 }
 
+// Move constructor
+Image::Image(Image &&other) noexcept
+    : Matrix(std::move(other)), filePath(std::move(other.filePath)), numChannels(other.numChannels), width(other.width), height(other.height)
+{
+    // Leaves the other image empty, matching its now empty Matrix base
+    other.numChannels = 0;
+    other.width = 0;
+    other.height = 0;
+}
+
+// Move assignment operator
+Image &Image::operator=(Image &&other) noexcept
+{
+    // Checks for self-assignment
+    if (this != &other)
+    {
+        // Takes ownership of the other image's data
+        filePath = std::move(other.filePath);
+        numChannels = other.numChannels;
+        width = other.width;
+        height = other.height;
+        Matrix::operator=(std::move(other));
+
+        other.numChannels = 0;
+        other.width = 0;
+        other.height = 0;
+    }
+
+    return *this;
+}
+
 // Destructor
 Image::~Image()
 {
@@ -97,39 +189,41 @@ Image::~Image()
 Image Image::operator*(double scalar) const
 {
     // YOUR CODE HERE
-    // Creates a new image object with the same data
+    // Creates a new image object and scales this image into it in a single pass
+    Image result;
+    scaleInto(result, scalar);
+    return result;
+}
+
+// Scaling an image in place
+void Image::scaleInPlace(double scalar)
+{
+    scaleInto(*this, scalar);
+}
+
+// Scaling an image into another image
+void Image::scaleInto(Image &destination, double scalar) const
+{
     if (scalar < 0.0 || scalar > 1.0)
     {
         throw std::out_of_range("Error (Matrix.cpp_*): scalar out of range");
     }
 
-    Image result = Image(*this);
-
-    for (int i = 0; i < height; ++i)
+    // Reuses the destination's buffer when it already has the right dimensions
+    if (&destination != this && (destination.width != width || destination.height != height || destination.numChannels != numChannels))
     {
-        for (int j = 0; j < width; ++j)
-        {
-            for (int k = 0; k < numChannels; ++k)
-            {
-                // Scale the pixel values and ensure they are within the valid range
-                // if (data[i][j * numChannels + k] * scalar < 0)
-                // {
-                //     result.data[i][j * numChannels + k] = 0;
-                // }
-                // else if (data[i][j * numChannels + k] * scalar > 255)
-                // {
-                //     result.data[i][j * numChannels + k] = 255;
-                // }
-                // else
-                // {
-                //     result.data[i][j * numChannels + k] = data[i][j * numChannels + k] * scalar;
-                // }
-                result.data[i][j * numChannels + k] = data[i][j * numChannels + k] * scalar;
-            }
-        }
+        destination = Image(filePath, numChannels, width, height);
     }
 
-    return result;
+    // The 256 possible results are computed once, then every byte is a table lookup or fixed-point multiply
+    kernels::ScaleTable table = kernels::makeScaleTable(scalar);
+    int rowBytes = width * numChannels;
+    ThreadPool::shared().parallelForRows(height, static_cast<size_t>(rowBytes), [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            kernels::scale(row(i), destination.row(i), rowBytes, table);
+        } });
 }
 
 // Adding two images
@@ -142,24 +236,18 @@ Image Image::operator+(const Image &other) const
         throw std::out_of_range("Error (Matrix.cpp_+): different matrix sizes");
     }
 
-    (*this) * 0.5;
-    (other) * 0.5;
-
-    // Creates a new image object with the same data
-    Image result = Image(*this);
+    // Creates a new image object and blends both images into it (each contributes half, so the sum stays within 0-255)
+    Image result(filePath, numChannels, width, height);
 
-    for (int i = 0; i < height; ++i)
+    int rowBytes = width * numChannels;
+    ThreadPool::shared().parallelForRows(height, static_cast<size_t>(rowBytes), [&](int first, int last)
     {
-        for (int j = 0; j < width; ++j)
+        for (int i = first; i < last; ++i)
         {
-            for (int k = 0; k < numChannels; ++k)
-            {
-                result.data[i][j * numChannels + k] = data[i][j * numChannels + k] + other.data[i][j * numChannels + k];
-            }
-        }
-    }
+            kernels::average(row(i), other.row(i), result.row(i), rowBytes);
+        } });
 
-    return result * 1;
+    return result;
 }
 
 // Subtracting two images
@@ -172,24 +260,18 @@ Image Image::operator-(const Image &other) const
         throw std::out_of_range("Error (Matrix.cpp_-): different matrix sizes");
     }
 
-    // Creates a new image object with the same data
-    (other) * 0.1;
-
-    Image result = Image(*this);
+    // Creates a new image object and subtracts the other image from this one (clamped at 0)
+    Image result(filePath, numChannels, width, height);
 
-    for (int i = 0; i < height; ++i)
+    int rowBytes = width * numChannels;
+    ThreadPool::shared().parallelForRows(height, static_cast<size_t>(rowBytes), [&](int first, int last)
     {
-        for (int j = 0; j < width; ++j)
+        for (int i = first; i < last; ++i)
         {
-            for (int k = 0; k < numChannels; ++k)
-            {
-                // result.data[i][j * numChannels + k] = data[i][j * numChannels + k] - other.data[i][j * numChannels + k];
-                result.data[i][j * numChannels + k] = other.data[i][j * numChannels + k];
-            }
-        }
-    }
+            kernels::subtractSaturate(row(i), other.row(i), result.row(i), rowBytes);
+        } });
 
-    return result * 1;
+    return result;
 }
 
 // Multiplying two images
@@ -197,29 +279,129 @@ Image Image::operator*(const Image &other) const
 {
     // YOUR CODE HERE
     // Checks to see if the sizes of both images are compatible
-    if (width != other.height)
+    if (width != other.height || numChannels != other.numChannels)
     {
         throw std::out_of_range("Error (Matrix.cpp_*): different respective matrix sizes");
     }
 
-    // Creates a new image object with the same data
-    Image result = Image(*this);
-    for (int i = 0; i < height; ++i)
+    // Creates a new image object (height x other.width) and multiplies each channel separately,
+    // normalizing every sum of products back to 0-255 (see Gemm.h)
+    Image result(filePath, numChannels, other.width, height);
+    gemm::multiply(data, stride, other.data, other.stride, result.data, result.stride, height, other.width, width, numChannels);
+
+    return result;
+}
+
+// Compound operators (write into this image's existing buffer)
+Image &Image::operator+=(const Image &other)
+{
+    blendInto(*this, *this, other, 0.5);
+    return *this;
+}
+
+Image &Image::operator-=(const Image &other)
+{
+    // Checks to see if the sizes of both images are compatible
+    if (height != other.height || width != other.width || numChannels != other.numChannels)
+    {
+        throw std::out_of_range("Error (Matrix.cpp_-=): different matrix sizes");
+    }
+
+    int rowBytes = width * numChannels;
+    ThreadPool::shared().parallelForRows(height, static_cast<size_t>(rowBytes), [&](int first, int last)
     {
-        for (int j = 0; j < other.width; ++j)
+        for (int i = first; i < last; ++i)
         {
-            for (int k = 0; k < width; ++k)
+            kernels::subtractSaturate(row(i), other.row(i), row(i), rowBytes);
+        } });
+
+    return *this;
+}
+
+Image &Image::operator*=(double scalar)
+{
+    scaleInPlace(scalar);
+    return *this;
+}
+
+// Weighted blend of two images into a third
+void Image::blendInto(Image &destination, const Image &a, const Image &b, double alpha)
+{
+    // Checks to see if the sizes of both images are compatible
+    if (a.height != b.height || a.width != b.width || a.numChannels != b.numChannels)
+    {
+        throw std::out_of_range("Error (Image.cpp_blendInto): different matrix sizes");
+    }
+    if (alpha < 0.0 || alpha > 1.0)
+    {
+        throw std::out_of_range("Error (Image.cpp_blendInto): alpha out of range");
+    }
+
+    // Reuses the destination's buffer when it already has the right dimensions
+    if (destination.width != a.width || destination.height != a.height || destination.numChannels != a.numChannels)
+    {
+        destination = Image(a.filePath, a.numChannels, a.width, a.height);
+    }
+
+    // alpha in 1/256 steps (0.5 gives exactly the same result as operator+)
+    int weight = static_cast<int>(alpha * 256.0 + 0.5);
+    int rowBytes = a.width * a.numChannels;
+    ThreadPool::shared().parallelForRows(a.height, static_cast<size_t>(rowBytes), [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            kernels::blend(a.row(i), b.row(i), destination.row(i), rowBytes, weight);
+        } });
+}
+
+// Splitting the pixels into one plane per channel
+void Image::toPlanar(uint8_t *const *planes, size_t planeStride) const
+{
+    if (planeStride < static_cast<size_t>(width))
+    {
+        throw std::invalid_argument("Error (Image.cpp_toPlanar): plane stride smaller than the width");
+    }
+    if (numChannels > 4)
+    {
+        throw std::invalid_argument("Error (Image.cpp_toPlanar): more than 4 channels");
+    }
+
+    ThreadPool::shared().parallelForRows(height, static_cast<size_t>(width) * numChannels, [&](int first, int last)
+    {
+        uint8_t *rowPlanes[4];
+        for (int i = first; i < last; ++i)
+        {
+            for (int c = 0; c < numChannels; c++)
             {
-                for (int l = 0; l < numChannels; ++l)
-                {
-                    // Multiplies the pixel values and ensures they are within the valid range by dividing by 255
-                    result.data[i][j * numChannels + l] = data[i][k * numChannels + l] * other.data[k][j * numChannels + l];
-                }
+                rowPlanes[c] = planes[c] + static_cast<size_t>(i) * planeStride;
             }
-        }
+            kernels::deinterleave(row(i), rowPlanes, width, numChannels);
+        } });
+}
+
+// Joining one plane per channel into the pixels
+void Image::fromPlanar(const uint8_t *const *planes, size_t planeStride)
+{
+    if (planeStride < static_cast<size_t>(width))
+    {
+        throw std::invalid_argument("Error (Image.cpp_fromPlanar): plane stride smaller than the width");
+    }
+    if (numChannels > 4)
+    {
+        throw std::invalid_argument("Error (Image.cpp_fromPlanar): more than 4 channels");
     }
 
-    return result * 1;
+    ThreadPool::shared().parallelForRows(height, static_cast<size_t>(width) * numChannels, [&](int first, int last)
+    {
+        const uint8_t *rowPlanes[4];
+        for (int i = first; i < last; ++i)
+        {
+            for (int c = 0; c < numChannels; c++)
+            {
+                rowPlanes[c] = planes[c] + static_cast<size_t>(i) * planeStride;
+            }
+            kernels::interleave(rowPlanes, row(i), width, numChannels);
+        } });
 }
 
 int Image::getWidth() const
@@ -232,24 +414,49 @@ int Image::getHeight() const
     return height;
 }
 
+int Image::getChannels() const
+{
+    return numChannels;
+}
+
 void Image::save(const std::string &filePath) const
 {
-    // Convert the Matrix data into a 1D array suitable for saving as an image
-    std::vector<uint8_t> imageData;
+    StageTimer timer("save");
 
-    for (int i = 0; i < height; ++i)
+    // Uncompressed formats are written straight from the pixel buffer
+    formats::Format format = formats::fromPath(filePath);
+    if (format == formats::Format::qoi)
     {
-        for (int j = 0; j < width; ++j)
-        {
-            for (int k = 0; k < numChannels; ++k)
-            {
-                imageData.push_back(data[i][j * numChannels + k]);
-            }
-        }
+        StageTimer encodeTimer("save.encode");
+        qoi::write(filePath, data, width, height, numChannels, stride);
+        return;
+    }
+    if (format != formats::Format::stb)
+    {
+        StageTimer writeTimer("save.write");
+        formats::write(filePath, format, data, width, height, numChannels, stride);
+        return;
     }
 
-    // Save the image data to the specified file using stb_image_write
-    stbi_write_png(filePath.c_str(), width, height, numChannels, imageData.data(), width * numChannels);
+    // Any other extension is saved as PNG, by this repo's parallel encoder at the lower effort levels (see Png.h)
+    StageTimer encodeTimer("save.encode");
+    if (png::getEffort() != png::Effort::best)
+    {
+        png::write(filePath, data, width, height, numChannels, stride, png::getEffort());
+        return;
+    }
+
+    // or by stb_image_write (the encoder reads the rows in place using the stride), into a file that
+    // replaces the target in one step (see FileIO.h)
+    fileio::ReplacementFile file(filePath);
+    auto writeBytes = [](void *context, void *bytes, int size)
+    {
+        std::fwrite(bytes, 1, static_cast<size_t>(size), static_cast<std::FILE *>(context));
+    };
+    if (!file.get() || stbi_write_png_to_func(writeBytes, file.get(), width, height, numChannels, data, stride) == 0 || !file.commit())
+    {
+        throw std::runtime_error("Error (Image.cpp_save): could not write " + filePath);
+    }
 }
 
 void Image::resize(int newWidth, int newHeight)
@@ -260,44 +467,36 @@ void Image::resize(int newWidth, int newHeight)
         throw std::invalid_argument("Error (Image.cpp_resize): invlid dimensions");
     }
 
-    // Declares vector objects to store the original and resized image data for the stbir_resize function
-    uint8_t *original = new uint8_t[height * width * numChannels];
-    uint8_t *resized = new uint8_t[newHeight * newWidth * numChannels];
-
-    for (int i = 0; i < height; ++i)
-    {
-        for (int j = 0; j < width; ++j)
-        {
-            for (int k = 0; k < numChannels; ++k)
-            {
-                // Copies the matrix data from the original image to the original vector
-                original[(i * width + j) * numChannels + k] = data[i][j * numChannels + k];
-            }
-        }
-    }
+    // Creates a new image object with the resized dimensions
+    Image resized(filePath, numChannels, newWidth, newHeight);
 
-    // Resizes the image using stb_image_resize
-    stbir_resize_uint8(original, width, height, width * numChannels, resized, newWidth, newHeight, newWidth * numChannels, numChannels);
+    // Resizes the image with the current filter (see Resample.h), reading from and writing to the pixel
+    // buffers directly (this thread's context keeps the weights, so same-sized resizes reuse them)
+    ResizeContext::forThread().resize(data, width, height, stride, resized.data, newWidth, newHeight, resized.stride, numChannels,
+                                      resample::getFilter());
 
-    // Creates a new image object with the resized dimensions
-    *this = Image(filePath, numChannels, newWidth, newHeight);
+    // Replaces this image with the resized one (updates the width and height as well)
+    *this = std::move(resized);
+}
 
-    for (int i = 0; i < newHeight; i++)
+// Resizing into a caller-provided image
+void Image::resizeInto(Image &destination, int newWidth, int newHeight, ResizeContext &context) const
+{
+    if (newWidth <= 0 || newHeight <= 0)
     {
-        for (int j = 0; j < newWidth; j++)
-        {
-            for (int k = 0; k < numChannels; k++)
-            {
-                // Copies the resized image data from the resized vector to the matrix data
-                data[i][j * numChannels + k] = resized[(i * newWidth + j) * numChannels + k];
-            }
-        }
+        throw std::invalid_argument("Error (Image.cpp_resizeInto): invalid dimensions");
+    }
+    if (&destination == this)
+    {
+        throw std::invalid_argument("Error (Image.cpp_resizeInto): destination is the source image");
     }
 
-    delete[] original;
-    delete[] resized;
+    // Reuses the destination's buffer when it already has the right dimensions
+    if (destination.width != newWidth || destination.height != newHeight || destination.numChannels != numChannels)
+    {
+        destination = Image(filePath, numChannels, newWidth, newHeight);
+    }
 
-    // Updates the width and height of the image
-    width = newWidth;
-    height = newHeight;
+    context.resize(data, width, height, stride, destination.data, newWidth, newHeight, destination.stride, numChannels,
+                   resample::getFilter());
 }
@@ -7,6 +7,8 @@
 #include <string>
 #include "Matrix.h"
 
+class ResizeContext;
+
 class Image : public Matrix
 {
 private:
@@ -30,30 +32,92 @@ public:
     // Assignment operator
     Image &operator=(const Image &other);
 
+    // Move constructor (transfers the pixel buffer without copying it)
+    Image(Image &&other) noexcept;
+
+    // Move assignment operator (transfers the pixel buffer without copying it)
+    Image &operator=(Image &&other) noexcept;
+
+    // Expression constructor and assignment (evaluates the expression in one pass; defined in Expr.h,
+    // which callers must include to use them)
+    template <typename E>
+    Image(const expr::Expression<E> &expression);
+    template <typename E>
+    Image &operator=(const expr::Expression<E> &expression);
+
     // Destructor
     ~Image();
 
     // Scaling an image
     Image operator*(double scalar) const;
 
-    // Adding two images
+    // Scaling an image in place (no allocation)
+    void scaleInPlace(double scalar);
+
+    /* Scaling an image into a caller-provided image (reallocated only if its dimensions differ)
+    ** @param destination: image that receives the scaled pixels
+    ** @param scalar: multiplier in [0, 1]
+    */
+    void scaleInto(Image &destination, double scalar) const;
+
+    // Adding two images (averaging blend: each image contributes half of every pixel)
     Image operator+(const Image &other) const;
 
-    // Subtracting two images
+    // Subtracting two images (saturating: differences below 0 are clamped to 0)
     Image operator-(const Image &other) const;
 
-    // Multiplying two images
+    // Multiplying two images (per-channel matrix product, normalized to 0-255)
     Image operator*(const Image &other) const;
 
-    // Resize function
+    // Blending another image into this one in place (same as *this = *this + other)
+    Image &operator+=(const Image &other);
+
+    // Subtracting another image from this one in place (saturating)
+    Image &operator-=(const Image &other);
+
+    // Scaling this image in place (same as scaleInPlace)
+    Image &operator*=(double scalar);
+
+    /* Weighted blend into an existing image: destination = a * alpha + b * (1 - alpha), rounded
+    ** The destination is reallocated only if its dimensions differ, and may be a or b.
+    ** @param destination: image that receives the blend
+    ** @param a, b: images of the same dimensions
+    ** @param alpha: weight of a in [0, 1]
+    */
+    static void blendInto(Image &destination, const Image &a, const Image &b, double alpha);
+
+    /* Copies the pixels into one plane per channel (packed to planar)
+    ** @param planes: getChannels() buffers, each at least (height - 1) * planeStride + width bytes
+    ** @param planeStride: bytes between rows of a plane (at least width)
+    */
+    void toPlanar(uint8_t *const *planes, size_t planeStride) const;
+
+    /* Replaces the pixels with ones read from one plane per channel (planar to packed)
+    ** @param planes: getChannels() buffers laid out as for toPlanar
+    ** @param planeStride: bytes between rows of a plane (at least width)
+    */
+    void fromPlanar(const uint8_t *const *planes, size_t planeStride);
+
+    // Resize function (with the filter set by resample::setFilter, see Resample.h)
     void resize(int newWidth, int newHeight);
 
+    /* Resizing into a caller-provided image (reallocated only if its dimensions differ)
+    ** Keeping the destination and context across same-sized frames makes each resize allocation-free.
+    ** @param destination: image that receives the resized pixels (must not be this image)
+    ** @param newWidth, newHeight: dimensions of the resized image
+    ** @param context: weights and working memory kept between resizes (see ResizeContext.h)
+    */
+    void resizeInto(Image &destination, int newWidth, int newHeight, ResizeContext &context) const;
+
     // Get width of the image
     int getWidth() const;
 
     // Get height of the image
     int getHeight() const;
 
+    // Get number of channels of the image
+    int getChannels() const;
+
     // Save image to a file
     void save(const std::string &filePath) const;
 };
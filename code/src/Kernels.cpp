@@ -0,0 +1,542 @@
+// Kernels.cpp
+
+#include "Kernels.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define KERNELS_X86 0
+#endif
+
+namespace
+{
+    // Signature shared by every binary byte kernel
+    typedef void (*BinaryKernel)(const uint8_t *, const uint8_t *, uint8_t *, size_t);
+
+    // Signature of the fixed-point scaling kernel
+    typedef void (*ScaleKernel)(const uint8_t *, uint8_t *, size_t, uint16_t);
+
+    // Signature of the weighted blend kernel
+    typedef void (*BlendKernel)(const uint8_t *, const uint8_t *, uint8_t *, size_t, int);
+
+    // Signatures of the packed to planar and planar to packed conversions
+    typedef void (*DeinterleaveKernel)(const uint8_t *, uint8_t *const *, size_t, int);
+    typedef void (*InterleaveKernel)(const uint8_t *const *, uint8_t *, size_t, int);
+
+    // The kernels selected for this CPU
+    struct KernelTable
+    {
+        const char *isa;
+        BinaryKernel addSaturate;
+        BinaryKernel subtractSaturate;
+        BinaryKernel average;
+        ScaleKernel scale;
+        BlendKernel blend;
+        DeinterleaveKernel deinterleave;
+        InterleaveKernel interleave;
+    };
+
+    // Scalar fallback (also handles the tails the vector loops leave over)
+    void addSaturateScalar(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            int sum = a[i] + b[i];
+            out[i] = static_cast<uint8_t>(sum > 255 ? 255 : sum);
+        }
+    }
+
+    void subtractSaturateScalar(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            int difference = a[i] - b[i];
+            out[i] = static_cast<uint8_t>(difference < 0 ? 0 : difference);
+        }
+    }
+
+    void averageScalar(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = static_cast<uint8_t>((a[i] + b[i] + 1) >> 1);
+        }
+    }
+
+    void scaleScalar(const uint8_t *in, uint8_t *out, size_t count, uint16_t factor)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = static_cast<uint8_t>((in[i] * static_cast<uint32_t>(factor)) >> 16);
+        }
+    }
+
+    void blendScalar(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count, int weight)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = static_cast<uint8_t>((a[i] * weight + b[i] * (256 - weight) + 128) >> 8);
+        }
+    }
+
+    // Converts pixels first to count - 1 one byte at a time (the vector kernels use this for their tails)
+    void deinterleaveRange(const uint8_t *packed, uint8_t *const *planes, size_t first, size_t count, int channels)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                planes[c][i] = packed[i * channels + c];
+            }
+        }
+    }
+
+    void interleaveRange(const uint8_t *const *planes, uint8_t *packed, size_t first, size_t count, int channels)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                packed[i * channels + c] = planes[c][i];
+            }
+        }
+    }
+
+    void deinterleaveScalar(const uint8_t *packed, uint8_t *const *planes, size_t count, int channels)
+    {
+        deinterleaveRange(packed, planes, 0, count, channels);
+    }
+
+    void interleaveScalar(const uint8_t *const *planes, uint8_t *packed, size_t count, int channels)
+    {
+        interleaveRange(planes, packed, 0, count, channels);
+    }
+
+#if KERNELS_X86
+// Defines one vector kernel: the main loop handles WIDTH bytes per iteration with OP and
+// the scalar version finishes the remaining bytes
+#define DEFINE_VECTOR_KERNEL(NAME, TARGET, VECTOR, WIDTH, LOAD, STORE, OP, SCALAR)          \
+    __attribute__((target(TARGET))) void NAME(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count) \
+    {                                                                                         \
+        size_t i = 0;                                                                         \
+        for (; i + WIDTH <= count; i += WIDTH)                                                \
+        {                                                                                     \
+            VECTOR va = LOAD(reinterpret_cast<const VECTOR *>(a + i));                        \
+            VECTOR vb = LOAD(reinterpret_cast<const VECTOR *>(b + i));                        \
+            STORE(reinterpret_cast<VECTOR *>(out + i), OP(va, vb));                           \
+        }                                                                                     \
+        SCALAR(a + i, b + i, out + i, count - i);                                             \
+    }
+
+    DEFINE_VECTOR_KERNEL(addSaturateSse2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_adds_epu8, addSaturateScalar)
+    DEFINE_VECTOR_KERNEL(subtractSaturateSse2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_subs_epu8, subtractSaturateScalar)
+    DEFINE_VECTOR_KERNEL(averageSse2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_avg_epu8, averageScalar)
+
+    DEFINE_VECTOR_KERNEL(addSaturateAvx2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_adds_epu8, addSaturateScalar)
+    DEFINE_VECTOR_KERNEL(subtractSaturateAvx2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_subs_epu8, subtractSaturateScalar)
+    DEFINE_VECTOR_KERNEL(averageAvx2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_avg_epu8, averageScalar)
+
+    DEFINE_VECTOR_KERNEL(addSaturateAvx512, "avx512bw", __m512i, 64, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_adds_epu8, addSaturateScalar)
+    DEFINE_VECTOR_KERNEL(subtractSaturateAvx512, "avx512bw", __m512i, 64, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_subs_epu8, subtractSaturateScalar)
+    DEFINE_VECTOR_KERNEL(averageAvx512, "avx512bw", __m512i, 64, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_avg_epu8, averageScalar)
+
+#undef DEFINE_VECTOR_KERNEL
+
+// Defines one fixed-point scaling kernel: widens WIDTH bytes to 16 bits, keeps the high half of
+// the product with the factor (pmulhuw) and packs the results back to bytes
+#define DEFINE_SCALE_KERNEL(NAME, TARGET, VECTOR, WIDTH, LOAD, STORE, SET1, ZERO, UNPACKLO, UNPACKHI, MULHI, PACK) \
+    __attribute__((target(TARGET))) void NAME(const uint8_t *in, uint8_t *out, size_t count, uint16_t factor)       \
+    {                                                                                                                 \
+        VECTOR zero = ZERO();                                                                                         \
+        VECTOR multiplier = SET1(static_cast<short>(factor));                                                         \
+        size_t i = 0;                                                                                                 \
+        for (; i + WIDTH <= count; i += WIDTH)                                                                        \
+        {                                                                                                             \
+            VECTOR bytes = LOAD(reinterpret_cast<const VECTOR *>(in + i));                                            \
+            VECTOR low = MULHI(UNPACKLO(bytes, zero), multiplier);                                                    \
+            VECTOR high = MULHI(UNPACKHI(bytes, zero), multiplier);                                                   \
+            STORE(reinterpret_cast<VECTOR *>(out + i), PACK(low, high));                                              \
+        }                                                                                                             \
+        scaleScalar(in + i, out + i, count - i, factor);                                                              \
+    }
+
+    // (the 256 and 512 bit unpacks and packs work within 128-bit lanes, so they undo each other and keep byte order)
+    DEFINE_SCALE_KERNEL(scaleSse2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_set1_epi16, _mm_setzero_si128,
+                        _mm_unpacklo_epi8, _mm_unpackhi_epi8, _mm_mulhi_epu16, _mm_packus_epi16)
+    DEFINE_SCALE_KERNEL(scaleAvx2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_set1_epi16, _mm256_setzero_si256,
+                        _mm256_unpacklo_epi8, _mm256_unpackhi_epi8, _mm256_mulhi_epu16, _mm256_packus_epi16)
+    DEFINE_SCALE_KERNEL(scaleAvx512, "avx512bw", __m512i, 64, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_set1_epi16, _mm512_setzero_si512,
+                        _mm512_unpacklo_epi8, _mm512_unpackhi_epi8, _mm512_mulhi_epu16, _mm512_packus_epi16)
+
+#undef DEFINE_SCALE_KERNEL
+
+// Defines one weighted blend kernel: a * w + b * (256 - w) + 128 fits in an unsigned 16-bit lane,
+// so both halves of each vector are blended with 16-bit multiplies and shifted back to bytes
+#define DEFINE_BLEND_KERNEL(NAME, TARGET, VECTOR, WIDTH, LOAD, STORE, SET1, ZERO, UNPACKLO, UNPACKHI, MULLO, ADD, SRLI, PACK) \
+    __attribute__((target(TARGET))) void NAME(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count, int weight)       \
+    {                                                                                                                           \
+        VECTOR zero = ZERO();                                                                                                   \
+        VECTOR weightA = SET1(static_cast<short>(weight));                                                                      \
+        VECTOR weightB = SET1(static_cast<short>(256 - weight));                                                                \
+        VECTOR half = SET1(128);                                                                                                \
+        size_t i = 0;                                                                                                           \
+        for (; i + WIDTH <= count; i += WIDTH)                                                                                  \
+        {                                                                                                                       \
+            VECTOR va = LOAD(reinterpret_cast<const VECTOR *>(a + i));                                                          \
+            VECTOR vb = LOAD(reinterpret_cast<const VECTOR *>(b + i));                                                          \
+            VECTOR low = ADD(ADD(MULLO(UNPACKLO(va, zero), weightA), MULLO(UNPACKLO(vb, zero), weightB)), half);                \
+            VECTOR high = ADD(ADD(MULLO(UNPACKHI(va, zero), weightA), MULLO(UNPACKHI(vb, zero), weightB)), half);               \
+            STORE(reinterpret_cast<VECTOR *>(out + i), PACK(SRLI(low, 8), SRLI(high, 8)));                                      \
+        }                                                                                                                       \
+        blendScalar(a + i, b + i, out + i, count - i, weight);                                                                  \
+    }
+
+    DEFINE_BLEND_KERNEL(blendSse2, "sse2", __m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_set1_epi16, _mm_setzero_si128,
+                        _mm_unpacklo_epi8, _mm_unpackhi_epi8, _mm_mullo_epi16, _mm_add_epi16, _mm_srli_epi16, _mm_packus_epi16)
+    DEFINE_BLEND_KERNEL(blendAvx2, "avx2", __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_set1_epi16, _mm256_setzero_si256,
+                        _mm256_unpacklo_epi8, _mm256_unpackhi_epi8, _mm256_mullo_epi16, _mm256_add_epi16, _mm256_srli_epi16, _mm256_packus_epi16)
+    DEFINE_BLEND_KERNEL(blendAvx512, "avx512bw", __m512i, 64, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_set1_epi16, _mm512_setzero_si512,
+                        _mm512_unpacklo_epi8, _mm512_unpackhi_epi8, _mm512_mullo_epi16, _mm512_add_epi16, _mm512_srli_epi16, _mm512_packus_epi16)
+
+#undef DEFINE_BLEND_KERNEL
+
+    // Byte shuffles for 16 RGB pixels (48 bytes in three vectors). deinterleave3Masks[c][v] moves the
+    // bytes of channel c held by packed vector v to their place in the plane; interleave3Masks[v][c]
+    // moves bytes of plane c to their place in packed vector v. Index 0x80 writes a zero.
+    alignas(16) const uint8_t deinterleave3Masks[3][3][16] = {
+        {{0, 3, 6, 9, 12, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 2, 5, 8, 11, 14, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 1, 4, 7, 10, 13}},
+        {{1, 4, 7, 10, 13, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {0x80, 0x80, 0x80, 0x80, 0x80, 0, 3, 6, 9, 12, 15, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 2, 5, 8, 11, 14}},
+        {{2, 5, 8, 11, 14, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {0x80, 0x80, 0x80, 0x80, 0x80, 1, 4, 7, 10, 13, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0, 3, 6, 9, 12, 15}}};
+    alignas(16) const uint8_t interleave3Masks[3][3][16] = {
+        {{0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80, 5},
+         {0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80},
+         {0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80}},
+        {{0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10, 0x80},
+         {5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10},
+         {0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80}},
+        {{0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80, 0x80},
+         {0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80},
+         {10, 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15}}};
+
+    // Groups the bytes of four RGBA pixels by channel (RRRR GGGG BBBB AAAA)
+    alignas(16) const uint8_t deinterleave4Mask[16] = {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15};
+
+    // Packed pixel access for the planar kernels. A vector covers 16 pixels per 128-bit lane: the
+    // SSSE3 kernels convert 16 pixels per iteration and the AVX2 ones 32, the high lane working on the
+    // second 16 (span bytes further on), so the in-lane shuffles and unpacks need no cross-lane fixup.
+    __attribute__((target("ssse3"))) inline __m128i loadMaskSsse3(const uint8_t *mask)
+    {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+    }
+
+    __attribute__((target("ssse3"))) inline __m128i loadPackedSsse3(const uint8_t *packed, size_t)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed));
+    }
+
+    __attribute__((target("ssse3"))) inline void storePackedSsse3(uint8_t *packed, size_t, __m128i value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(packed), value);
+    }
+
+    __attribute__((target("avx2"))) inline __m256i loadMaskAvx2(const uint8_t *mask)
+    {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(mask)));
+    }
+
+    __attribute__((target("avx2"))) inline __m256i loadPackedAvx2(const uint8_t *packed, size_t span)
+    {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + span));
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+    }
+
+    __attribute__((target("avx2"))) inline void storePackedAvx2(uint8_t *packed, size_t span, __m256i value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(packed), _mm256_castsi256_si128(value));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(packed + span), _mm256_extracti128_si256(value, 1));
+    }
+
+// Defines the deinterleave and interleave kernels for one instruction set. P is the intrinsic prefix
+// (_mm or _mm256); 3 channels are moved with three byte shuffles per vector, 4 channels with one
+// shuffle and a 4 x 4 transpose of 32-bit words, and other channel counts one byte at a time.
+#define DEFINE_PLANAR_KERNELS(SUFFIX, TARGET, VECTOR, PIXELS, P, LOAD, STORE, OR)                                                                   \
+    __attribute__((target(TARGET))) void deinterleave##SUFFIX(const uint8_t *packed, uint8_t *const *planes, size_t count, int channels)            \
+    {                                                                                                                                               \
+        size_t i = 0;                                                                                                                               \
+        if (channels == 3)                                                                                                                          \
+        {                                                                                                                                           \
+            VECTOR masks[3][3];                                                                                                                     \
+            for (int m = 0; m < 9; m++)                                                                                                             \
+            {                                                                                                                                       \
+                masks[m / 3][m % 3] = loadMask##SUFFIX(deinterleave3Masks[m / 3][m % 3]);                                                           \
+            }                                                                                                                                       \
+            for (; i + PIXELS <= count; i += PIXELS)                                                                                                \
+            {                                                                                                                                       \
+                const uint8_t *in = packed + i * 3;                                                                                                 \
+                VECTOR v0 = loadPacked##SUFFIX(in, 48);                                                                                             \
+                VECTOR v1 = loadPacked##SUFFIX(in + 16, 48);                                                                                        \
+                VECTOR v2 = loadPacked##SUFFIX(in + 32, 48);                                                                                        \
+                for (int c = 0; c < 3; c++)                                                                                                         \
+                {                                                                                                                                   \
+                    VECTOR plane = OR(OR(P##_shuffle_epi8(v0, masks[c][0]), P##_shuffle_epi8(v1, masks[c][1])), P##_shuffle_epi8(v2, masks[c][2])); \
+                    STORE(reinterpret_cast<VECTOR *>(planes[c] + i), plane);                                                                        \
+                }                                                                                                                                   \
+            }                                                                                                                                       \
+        }                                                                                                                                           \
+        else if (channels == 4)                                                                                                                     \
+        {                                                                                                                                           \
+            VECTOR mask = loadMask##SUFFIX(deinterleave4Mask);                                                                                      \
+            for (; i + PIXELS <= count; i += PIXELS)                                                                                                \
+            {                                                                                                                                       \
+                const uint8_t *in = packed + i * 4;                                                                                                 \
+                VECTOR s0 = P##_shuffle_epi8(loadPacked##SUFFIX(in, 64), mask);                                                                     \
+                VECTOR s1 = P##_shuffle_epi8(loadPacked##SUFFIX(in + 16, 64), mask);                                                                \
+                VECTOR s2 = P##_shuffle_epi8(loadPacked##SUFFIX(in + 32, 64), mask);                                                                \
+                VECTOR s3 = P##_shuffle_epi8(loadPacked##SUFFIX(in + 48, 64), mask);                                                                \
+                VECTOR rg01 = P##_unpacklo_epi32(s0, s1);                                                                                           \
+                VECTOR ba01 = P##_unpackhi_epi32(s0, s1);                                                                                           \
+                VECTOR rg23 = P##_unpacklo_epi32(s2, s3);                                                                                           \
+                VECTOR ba23 = P##_unpackhi_epi32(s2, s3);                                                                                           \
+                STORE(reinterpret_cast<VECTOR *>(planes[0] + i), P##_unpacklo_epi64(rg01, rg23));                                                   \
+                STORE(reinterpret_cast<VECTOR *>(planes[1] + i), P##_unpackhi_epi64(rg01, rg23));                                                   \
+                STORE(reinterpret_cast<VECTOR *>(planes[2] + i), P##_unpacklo_epi64(ba01, ba23));                                                   \
+                STORE(reinterpret_cast<VECTOR *>(planes[3] + i), P##_unpackhi_epi64(ba01, ba23));                                                   \
+            }                                                                                                                                       \
+        }                                                                                                                                           \
+        deinterleaveRange(packed, planes, i, count, channels);                                                                                      \
+    }                                                                                                                                               \
+                                                                                                                                                    \
+    __attribute__((target(TARGET))) void interleave##SUFFIX(const uint8_t *const *planes, uint8_t *packed, size_t count, int channels)              \
+    {                                                                                                                                               \
+        size_t i = 0;                                                                                                                               \
+        if (channels == 3)                                                                                                                          \
+        {                                                                                                                                           \
+            VECTOR masks[3][3];                                                                                                                     \
+            for (int m = 0; m < 9; m++)                                                                                                             \
+            {                                                                                                                                       \
+                masks[m / 3][m % 3] = loadMask##SUFFIX(interleave3Masks[m / 3][m % 3]);                                                             \
+            }                                                                                                                                       \
+            for (; i + PIXELS <= count; i += PIXELS)                                                                                                \
+            {                                                                                                                                       \
+                VECTOR r = LOAD(reinterpret_cast<const VECTOR *>(planes[0] + i));                                                                   \
+                VECTOR g = LOAD(reinterpret_cast<const VECTOR *>(planes[1] + i));                                                                   \
+                VECTOR b = LOAD(reinterpret_cast<const VECTOR *>(planes[2] + i));                                                                   \
+                uint8_t *out = packed + i * 3;                                                                                                      \
+                for (int v = 0; v < 3; v++)                                                                                                         \
+                {                                                                                                                                   \
+                    VECTOR bytes = OR(OR(P##_shuffle_epi8(r, masks[v][0]), P##_shuffle_epi8(g, masks[v][1])), P##_shuffle_epi8(b, masks[v][2]));    \
+                    storePacked##SUFFIX(out + 16 * v, 48, bytes);                                                                                   \
+                }                                                                                                                                   \
+            }                                                                                                                                       \
+        }                                                                                                                                           \
+        else if (channels == 4)                                                                                                                     \
+        {                                                                                                                                           \
+            for (; i + PIXELS <= count; i += PIXELS)                                                                                                \
+            {                                                                                                                                       \
+                VECTOR r = LOAD(reinterpret_cast<const VECTOR *>(planes[0] + i));                                                                   \
+                VECTOR g = LOAD(reinterpret_cast<const VECTOR *>(planes[1] + i));                                                                   \
+                VECTOR b = LOAD(reinterpret_cast<const VECTOR *>(planes[2] + i));                                                                   \
+                VECTOR a = LOAD(reinterpret_cast<const VECTOR *>(planes[3] + i));                                                                   \
+                VECTOR rgLow = P##_unpacklo_epi8(r, g);                                                                                             \
+                VECTOR rgHigh = P##_unpackhi_epi8(r, g);                                                                                            \
+                VECTOR baLow = P##_unpacklo_epi8(b, a);                                                                                             \
+                VECTOR baHigh = P##_unpackhi_epi8(b, a);                                                                                            \
+                uint8_t *out = packed + i * 4;                                                                                                      \
+                storePacked##SUFFIX(out, 64, P##_unpacklo_epi16(rgLow, baLow));                                                                     \
+                storePacked##SUFFIX(out + 16, 64, P##_unpackhi_epi16(rgLow, baLow));                                                                \
+                storePacked##SUFFIX(out + 32, 64, P##_unpacklo_epi16(rgHigh, baHigh));                                                              \
+                storePacked##SUFFIX(out + 48, 64, P##_unpackhi_epi16(rgHigh, baHigh));                                                              \
+            }                                                                                                                                       \
+        }                                                                                                                                           \
+        interleaveRange(planes, packed, i, count, channels);                                                                                        \
+    }
+
+    DEFINE_PLANAR_KERNELS(Ssse3, "ssse3", __m128i, 16, _mm, _mm_loadu_si128, _mm_storeu_si128, _mm_or_si128)
+    DEFINE_PLANAR_KERNELS(Avx2, "avx2", __m256i, 32, _mm256, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_or_si256)
+
+#undef DEFINE_PLANAR_KERNELS
+#endif
+
+    // Picks the widest instruction set that may be used
+    KernelTable selectKernels()
+    {
+#if KERNELS_X86
+        // (the planar kernels have no AVX-512 version, and their 128-bit version needs SSSE3's byte shuffle)
+        if (kernels::isaEnabled("avx512"))
+        {
+            return {"avx512", addSaturateAvx512, subtractSaturateAvx512, averageAvx512, scaleAvx512, blendAvx512, deinterleaveAvx2, interleaveAvx2};
+        }
+        if (kernels::isaEnabled("avx2"))
+        {
+            return {"avx2", addSaturateAvx2, subtractSaturateAvx2, averageAvx2, scaleAvx2, blendAvx2, deinterleaveAvx2, interleaveAvx2};
+        }
+        if (kernels::isaEnabled("sse2"))
+        {
+            if (kernels::isaEnabled("ssse3"))
+            {
+                return {"sse2", addSaturateSse2, subtractSaturateSse2, averageSse2, scaleSse2, blendSse2, deinterleaveSsse3, interleaveSsse3};
+            }
+            return {"sse2", addSaturateSse2, subtractSaturateSse2, averageSse2, scaleSse2, blendSse2, deinterleaveScalar, interleaveScalar};
+        }
+#endif
+        return {"scalar", addSaturateScalar, subtractSaturateScalar, averageScalar, nullptr, blendScalar, deinterleaveScalar, interleaveScalar};
+    }
+
+    // Selected once, on first use
+    const KernelTable &table()
+    {
+        static const KernelTable selected = selectKernels();
+        return selected;
+    }
+}
+
+namespace kernels
+{
+    void addSaturate(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+    {
+        table().addSaturate(a, b, out, count);
+    }
+
+    void subtractSaturate(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+    {
+        table().subtractSaturate(a, b, out, count);
+    }
+
+    void average(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+    {
+        table().average(a, b, out, count);
+    }
+
+    void blend(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count, int weight)
+    {
+        table().blend(a, b, out, count, weight);
+    }
+
+    void deinterleave(const uint8_t *packed, uint8_t *const *planes, size_t count, int channels)
+    {
+        table().deinterleave(packed, planes, count, channels);
+    }
+
+    void interleave(const uint8_t *const *planes, uint8_t *packed, size_t count, int channels)
+    {
+        table().interleave(planes, packed, count, channels);
+    }
+
+    ScaleTable makeScaleTable(double scalar)
+    {
+        ScaleTable table;
+        for (int value = 0; value < 256; value++)
+        {
+            table.lut[value] = static_cast<uint8_t>(value * scalar);
+        }
+
+        table.identity = true;
+        for (int value = 0; value < 256; value++)
+        {
+            table.identity = table.identity && table.lut[value] == value;
+        }
+
+        // Looks for a 16-bit factor near scalar * 2^16 that gives the same result as the table for every byte
+        table.factor = 0;
+        table.exactFactor = false;
+        double ideal = scalar * 65536.0;
+        for (int candidate = static_cast<int>(ideal) - 1; candidate <= static_cast<int>(ideal) + 2 && !table.exactFactor; candidate++)
+        {
+            if (candidate < 0 || candidate > 65535)
+            {
+                continue;
+            }
+            bool matches = true;
+            for (int value = 0; value < 256 && matches; value++)
+            {
+                matches = ((value * candidate) >> 16) == table.lut[value];
+            }
+            if (matches)
+            {
+                table.factor = static_cast<uint16_t>(candidate);
+                table.exactFactor = true;
+            }
+        }
+
+        return table;
+    }
+
+    void scale(const uint8_t *in, uint8_t *out, size_t count, const ScaleTable &table)
+    {
+        if (table.identity)
+        {
+            if (in != out)
+            {
+                std::memcpy(out, in, count);
+            }
+            return;
+        }
+
+        ScaleKernel kernel = ::table().scale;
+        if (kernel != nullptr && table.exactFactor)
+        {
+            kernel(in, out, count, table.factor);
+            return;
+        }
+
+        // Lookup table (scalar fallback, and scalars such as 1.0 that no 16-bit factor reproduces)
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = table.lut[in[i]];
+        }
+    }
+
+    bool isaEnabled(const char *isa)
+    {
+        // Instruction sets from narrowest to widest; IMAGE_SIMD excludes everything wider than it names
+        const char *order[] = {"scalar", "sse2", "ssse3", "avx2", "avx512"};
+        int level = -1, capLevel = 4;
+        const char *cap = std::getenv("IMAGE_SIMD");
+        for (int i = 0; i < 5; i++)
+        {
+            if (std::strcmp(isa, order[i]) == 0)
+            {
+                level = i;
+            }
+            if (cap != nullptr && std::strcmp(cap, order[i]) == 0)
+            {
+                capLevel = i;
+            }
+        }
+        if (level < 0 || level > capLevel)
+        {
+            return false;
+        }
+
+#if KERNELS_X86
+        __builtin_cpu_init();
+        switch (level)
+        {
+        case 1:
+            return __builtin_cpu_supports("sse2");
+        case 2:
+            return __builtin_cpu_supports("ssse3");
+        case 3:
+            return __builtin_cpu_supports("avx2");
+        case 4:
+            return __builtin_cpu_supports("avx512bw");
+        }
+#endif
+        return level == 0;
+    }
+
+    const char *activeIsa()
+    {
+        return table().isa;
+    }
+}
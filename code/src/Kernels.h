@@ -0,0 +1,99 @@
+// Kernels.h
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-byte pixel kernels. Each function picks the widest instruction set the CPU supports
+// (AVX-512BW, AVX2, SSE2 or a scalar fallback) once, the first time any kernel is used.
+// Setting the IMAGE_SIMD environment variable to scalar, sse2, ssse3, avx2 or avx512 caps the choice
+// (ssse3 only adds the planar conversions' byte shuffles to sse2).
+namespace kernels
+{
+    /* Saturating addition: out[i] = min(a[i] + b[i], 255)
+    ** @param a, b: input bytes
+    ** @param out: output bytes (may alias a or b)
+    ** @param count: number of bytes
+    */
+    void addSaturate(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count);
+
+    /* Saturating subtraction: out[i] = max(a[i] - b[i], 0)
+    ** @param a, b: input bytes
+    ** @param out: output bytes (may alias a or b)
+    ** @param count: number of bytes
+    */
+    void subtractSaturate(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count);
+
+    /* Averaging blend, rounding up: out[i] = (a[i] + b[i] + 1) / 2
+    ** @param a, b: input bytes
+    ** @param out: output bytes (may alias a or b)
+    ** @param count: number of bytes
+    */
+    void average(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count);
+
+    /* Weighted blend: out[i] = round(a[i] * weight / 256 + b[i] * (256 - weight) / 256)
+    ** @param a, b: input bytes
+    ** @param out: output bytes (may alias a or b)
+    ** @param count: number of bytes
+    ** @param weight: weight of a in 1/256 units (0-256, 128 is the same as average)
+    */
+    void blend(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count, int weight);
+
+    /* Splits packed pixels into one plane per channel: planes[c][i] = packed[i * channels + c]
+    ** @param packed: count pixels of channels bytes each
+    ** @param planes: channels output rows of count bytes
+    ** @param count: number of pixels
+    ** @param channels: 1 to 4 (3 and 4 channels use vector shuffles, others are converted byte by byte)
+    */
+    void deinterleave(const uint8_t *packed, uint8_t *const *planes, size_t count, int channels);
+
+    /* Joins one plane per channel into packed pixels: packed[i * channels + c] = planes[c][i]
+    ** @param planes: channels input rows of count bytes
+    ** @param packed: count pixels of channels bytes each
+    ** @param count: number of pixels
+    ** @param channels: 1 to 4 (3 and 4 channels use vector shuffles, others are converted byte by byte)
+    */
+    void interleave(const uint8_t *const *planes, uint8_t *packed, size_t count, int channels);
+
+    // Precomputed multiplier for scale(): out = (uint8_t)(in * scalar), truncated like a double multiply
+    struct ScaleTable
+    {
+        // Result for every input byte (used by the scalar path)
+        uint8_t lut[256];
+
+        // 0.16 fixed-point multiplier, out = (in * factor) >> 16 (used by the SIMD paths)
+        uint16_t factor;
+
+        // Whether factor reproduces lut exactly for every input (otherwise the SIMD paths use lut too)
+        bool exactFactor;
+
+        // Whether the scalar leaves every byte unchanged (1.0), so scaling is a plain copy
+        bool identity;
+    };
+
+    /* Builds the table for one scalar
+    ** @param scalar: multiplier in [0, 1]
+    ** @return: lookup table and, when one matches the table exactly, a fixed-point factor
+    */
+    ScaleTable makeScaleTable(double scalar);
+
+    /* Scales bytes by a precomputed scalar: out[i] = table.lut[in[i]]
+    ** @param in: input bytes
+    ** @param out: output bytes (may be the same as in)
+    ** @param count: number of bytes
+    ** @param table: table from makeScaleTable
+    */
+    void scale(const uint8_t *in, uint8_t *out, size_t count, const ScaleTable &table);
+
+    /* Whether code for an instruction set may be used: the CPU supports it and IMAGE_SIMD does not exclude it
+    ** @param isa: "sse2", "ssse3", "avx2" or "avx512" (AVX-512BW)
+    */
+    bool isaEnabled(const char *isa);
+
+    // Name of the instruction set the kernels dispatch to ("avx512", "avx2", "sse2" or "scalar")
+    const char *activeIsa();
+}
+
+#endif // KERNELS_H
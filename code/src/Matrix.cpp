@@ -1,14 +1,50 @@
 // Matrix.cpp
 
 #include "Matrix.h"
+#include "Gemm.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include "Transpose.h"
+#include <cstring>
 #include <stdexcept>
+#include <utility>
+
+// Running total of bytes copied between matrices
+std::atomic<size_t> Matrix::bytesCopied(0);
 
 // Default constructor
-Matrix::Matrix() : numRows(0), numCols(0) {}
+Matrix::Matrix() : data(nullptr), stride(0), numRows(0), numCols(0) {}
+
+// Frees the pixel buffer with the matching deallocator
+void Matrix::releaseData()
+{
+    if (release)
+    {
+        release(data);
+        release = nullptr;
+    }
+    else
+    {
+        delete[] data;
+    }
+    data = nullptr;
+}
+
+// Allocates a zeroed, contiguous buffer for the given dimensions
+void Matrix::allocate(int rows, int cols)
+{
+    numRows = rows;
+    numCols = cols;
+    stride = cols;
+
+    // A single allocation holds every row, so rows are laid out back to back
+    size_t bytes = static_cast<size_t>(numRows) * stride;
+    data = bytes > 0 ? new uint8_t[bytes]{} : nullptr;
+}
 
 // Constructor with rows and columns
 // YOUR CODE HERE
-Matrix::Matrix(int rows, int cols) : numRows(rows), numCols(cols)
+Matrix::Matrix(int rows, int cols) : data(nullptr), stride(0), numRows(rows), numCols(cols)
 {
     // Checks for invalid row or column values
     if (numRows < 0 || numCols < 0)
@@ -17,31 +53,38 @@ Matrix::Matrix(int rows, int cols) : numRows(rows), numCols(cols)
     }
 
     // Allocates memory for the matrix of the specified dimensions
-    data = Vector<Vector<uint8_t>>(numRows);
-    for (int i = 0; i < numRows; i++)
-    {
-        data[i] = Vector<uint8_t>(numCols);
-    }
+    allocate(rows, cols);
 };
 
 // Copy constructor
 // YOUR CODE HERE
-Matrix::Matrix(const Matrix &other) : numRows(other.numRows), numCols(other.numCols)
+Matrix::Matrix(const Matrix &other) : data(nullptr), stride(0), numRows(0), numCols(0)
 {
     // Allocates memory for the matrix of the same dimensions
-    data = Vector<Vector<uint8_t>>(numRows);
-    for (int i = 0; i < numRows; i++)
-    {
-        data[i] = Vector<uint8_t>(numCols);
+    allocate(other.numRows, other.numCols);
 
-        // Copies the data from the other matrix
-        for (int j = 0; j < numCols; j++)
+    // Copies the data from the other matrix one row at a time (the strides may differ)
+    ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
         {
-            data[i][j] = other.data[i][j];
-        }
-    }
+            std::memcpy(row(i), other.row(i), numCols);
+        } });
+
+    bytesCopied += static_cast<size_t>(numRows) * numCols;
 };
 
+// Move constructor
+Matrix::Matrix(Matrix &&other) noexcept
+    : data(other.data), stride(other.stride), numRows(other.numRows), numCols(other.numCols), release(std::move(other.release))
+{
+    // Takes ownership of the other matrix's buffer and leaves it empty
+    other.data = nullptr;
+    other.stride = 0;
+    other.numRows = 0;
+    other.numCols = 0;
+}
+
 // Assignment operator
 Matrix &Matrix::operator=(const Matrix &other)
 {
@@ -52,31 +95,70 @@ Matrix &Matrix::operator=(const Matrix &other)
         // Checks to see if data needs to be reallocated depending on the compatibility of the sizes of both matrices
         if (numRows != other.getRows() || numCols != other.getCols())
         {
-            numRows = other.getRows();
-            numCols = other.getCols();
-
-            data = Vector<Vector<uint8_t>>(numRows);
-            for (int i = 0; i < numRows; i++)
-            {
-                data[i] = Vector<uint8_t>(numCols);
-            }
+            releaseData();
+            allocate(other.getRows(), other.getCols());
         }
 
         // Copies the data from the other matrix
-        for (int i = 0; i < numRows; i++)
+        ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
         {
-            for (int j = 0; j < numCols; j++)
+            for (int i = first; i < last; ++i)
             {
-                data[i][j] = other.data[i][j];
-            }
-        }
+                std::memcpy(row(i), other.row(i), numCols);
+            } });
+        bytesCopied += static_cast<size_t>(numRows) * numCols;
+    }
+
+    return *this;
+}
+
+// Move assignment operator
+Matrix &Matrix::operator=(Matrix &&other) noexcept
+{
+    // Checks for self-assignment
+    if (this != &other)
+    {
+        // Releases the current buffer and takes ownership of the other matrix's buffer
+        releaseData();
+        data = other.data;
+        stride = other.stride;
+        numRows = other.numRows;
+        numCols = other.numCols;
+        release = std::move(other.release);
+
+        other.data = nullptr;
+        other.release = nullptr;
+        other.stride = 0;
+        other.numRows = 0;
+        other.numCols = 0;
     }
 
     return *this;
 }
 
 // Destructor
-Matrix::~Matrix() {}
+Matrix::~Matrix()
+{
+    // Deallocates the pixel buffer
+    releaseData();
+}
+
+// Takes ownership of an existing pixel buffer
+void Matrix::adopt(uint8_t *buffer, int rows, int cols, int stride, std::function<void(uint8_t *)> release)
+{
+    // Checks for invalid dimensions or a stride that would make rows overlap
+    if (rows < 0 || cols < 0 || stride < cols)
+    {
+        throw std::out_of_range("Error (Matrix.cpp_adopt): invalid dimensions");
+    }
+
+    releaseData();
+    this->data = buffer;
+    this->stride = stride;
+    this->numRows = rows;
+    this->numCols = cols;
+    this->release = std::move(release);
+}
 
 // Number of rows
 int Matrix::getRows() const
@@ -90,6 +172,34 @@ int Matrix::getCols() const
     return numCols;
 }
 
+// Row stride in bytes
+int Matrix::getStride() const
+{
+    return stride;
+}
+
+// Pixel buffer
+uint8_t *Matrix::getData()
+{
+    return data;
+}
+
+const uint8_t *Matrix::getData() const
+{
+    return data;
+}
+
+// Copied byte counter
+size_t Matrix::getBytesCopied()
+{
+    return bytesCopied.load();
+}
+
+void Matrix::resetBytesCopied()
+{
+    bytesCopied = 0;
+}
+
 // Input stream operator
 std::istream &operator>>(std::istream &in, Matrix &mat)
 {
@@ -97,9 +207,10 @@ std::istream &operator>>(std::istream &in, Matrix &mat)
     // Inputs the data into the input stream
     for (int i = 0; i < mat.getRows(); i++)
     {
+        uint8_t *row = mat.row(i);
         for (int j = 0; j < mat.getCols(); j++)
         {
-            in >> mat.data[i][j];
+            in >> row[j];
         }
     }
 
@@ -113,9 +224,10 @@ std::ostream &operator<<(std::ostream &out, const Matrix &mat)
     // Outputs the data into the output stream
     for (int i = 0; i < mat.getRows(); i++)
     {
+        const uint8_t *row = mat.row(i);
         for (int j = 0; j < mat.getCols(); j++)
         {
-            out << mat.data[i][j] << " ";
+            out << row[j] << " ";
         }
         out << "\n";
     }
@@ -135,14 +247,13 @@ Matrix Matrix::operator+(const Matrix &other) const
 
     // Creates a new matrix object with the same dimension
     Matrix result(numRows, numCols);
-    for (int i = 0; i < numRows; i++)
+    ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
     {
-        for (int j = 0; j < numCols; j++)
+        for (int i = first; i < last; ++i)
         {
-            // Adds the data from both matrices and stores it in the new matrix
-            result.data[i][j] = data[i][j] + other.data[i][j];
-        }
-    }
+            // Adds the data from both matrices (clamped at 255) and stores it in the new matrix
+            kernels::addSaturate(row(i), other.row(i), result.row(i), numCols);
+        } });
 
     return result;
 }
@@ -158,14 +269,13 @@ Matrix Matrix::operator-(const Matrix &other) const
 
     // Creates a new matrix object with the same dimension
     Matrix result(numRows, numCols);
-    for (int i = 0; i < numRows; i++)
+    ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
     {
-        for (int j = 0; j < numCols; j++)
+        for (int i = first; i < last; ++i)
         {
-            // Subtracts the data from both matrices and stores it in the new matrix
-            result.data[i][j] = data[i][j] - other.data[i][j];
-        }
-    }
+            // Subtracts the data from both matrices (clamped at 0) and stores it in the new matrix
+            kernels::subtractSaturate(row(i), other.row(i), result.row(i), numCols);
+        } });
 
     return result;
 }
@@ -180,59 +290,103 @@ Matrix Matrix::operator*(const Matrix &other) const
     }
 
     // Creates a new matrix object with the respective dimensions for the cross product of both matrices
+    // (each entry is the mean of its products, rescaled to 0-255, see Gemm.h)
     Matrix result(numRows, other.getCols());
-    for (int i = 0; i < numRows; i++)
+    gemm::multiply(data, stride, other.data, other.stride, result.data, result.stride, numRows, other.getCols(), numCols, 1);
+    return result;
+}
+
+// Compound operators (write into this matrix's existing buffer)
+Matrix &Matrix::operator+=(const Matrix &other)
+{
+    // Checks to see if the sizes of both matrices are compatible
+    if (numRows != other.getRows() || numCols != other.getCols())
     {
-        for (int j = 0; j < other.getCols(); j++)
+        throw std::invalid_argument("Error (Matrix.cpp_+=): different matrix sizes");
+    }
+
+    ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
         {
-            for (int k = 0; k < numCols; k++)
-            {
-                // Stores the values of the cross product in the new matrix
-                result.data[i][j] = data[i][k] * other.data[k][j];
-            }
-        }
+            kernels::addSaturate(row(i), other.row(i), row(i), numCols);
+        } });
+
+    return *this;
+}
+
+Matrix &Matrix::operator-=(const Matrix &other)
+{
+    // Checks to see if the sizes of both matrices are compatible
+    if (numRows != other.getRows() || numCols != other.getCols())
+    {
+        throw std::invalid_argument("Error (Matrix.cpp_-=): different matrix sizes");
     }
-    return result;
+
+    ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            kernels::subtractSaturate(row(i), other.row(i), row(i), numCols);
+        } });
+
+    return *this;
+}
+
+Matrix &Matrix::operator*=(double scalar)
+{
+    if (scalar < 0.0 || scalar > 1.0)
+    {
+        throw std::out_of_range("Error (Matrix.cpp_*=): scalar out of range");
+    }
+
+    kernels::ScaleTable table = kernels::makeScaleTable(scalar);
+    ThreadPool::shared().parallelForRows(numRows, static_cast<size_t>(numCols), [&](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            kernels::scale(row(i), row(i), numCols, table);
+        } });
+
+    return *this;
 }
 
 // Subscript operator
-Vector<uint8_t> &Matrix::operator[](int index)
+RowView<uint8_t> Matrix::operator[](int index)
 {
     // YOUR CODE HERE
-    // Checks to see if the index is within bounds
-    if (index < 0 || index >= numRows)
+    // Checks to see if the index is within bounds (debug builds only)
+    if (BOUNDS_CHECK && (index < 0 || index >= numRows))
     {
         throw std::out_of_range("Error (Matrix.cpp_[]): index out of bounds");
     }
-    return data[index];
+    return RowView<uint8_t>(row(index), numCols);
 }
 
-const Vector<uint8_t> &Matrix::operator[](int index) const
+RowView<const uint8_t> Matrix::operator[](int index) const
 {
     // YOUR CODE HERE
-    // Checks to see if the index is within bounds
-    if (index < 0 || index >= numRows)
+    // Checks to see if the index is within bounds (debug builds only)
+    if (BOUNDS_CHECK && (index < 0 || index >= numRows))
     {
         throw std::out_of_range("Error (Matrix.cpp_const[]const): index out of bounds");
     }
-    return data[index];
+    return RowView<const uint8_t>(row(index), numCols);
 }
 
 // Transpose function (in-place)
 void Matrix::transpose()
 {
     // YOUR CODE HERE
-    // Creates a new matrix object with the respective dimensions for the transposed matrix
-    Matrix result(numCols, numRows);
-    for (int i = 0; i < numRows; i++)
+    // Square matrices are transposed in place, block by block
+    if (numRows == numCols)
     {
-        for (int j = 0; j < numCols; j++)
-        {
-            // Stores the values of the transposed matrix in the new matrix
-            result.data[j][i] = data[i][j];
-        }
+        transpose::squareInPlace(data, stride, numRows, 1);
+        return;
     }
 
-    // Copies the data from the new matrix to the original matrix
-    *this = result;
+    // Otherwise creates a new matrix object with the respective dimensions and moves it into this one
+    Matrix result(numCols, numRows);
+    transpose::outOfPlace(data, stride, result.data, result.stride, numRows, numCols, 1);
+    *this = std::move(result);
 }
@@ -4,19 +4,47 @@
 #define MATRIX_H
 
 #include <iostream>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include "Vector.h"
+#include <functional>
+#include "RowView.h"
+
+namespace expr
+{
+    template <typename Derived>
+    class Expression;
+}
 
 class Matrix
 {
 
 protected:
-    Vector<Vector<uint8_t>> data;
+    // Contiguous row-major pixel buffer (numRows * stride bytes)
+    uint8_t *data;
+
+    // Number of bytes between the starts of two consecutive rows (>= numCols)
+    int stride;
 
 private:
     int numRows;
     int numCols;
 
+    // Frees an adopted buffer (empty when the buffer was allocated with new[])
+    std::function<void(uint8_t *)> release;
+
+    // Frees the pixel buffer with the matching deallocator and leaves the matrix without one
+    void releaseData();
+
+    /* Allocates a zeroed buffer for the given dimensions
+    ** @param rows: number of rows
+    ** @param cols: number of columns
+    */
+    void allocate(int rows, int cols);
+
+    // Running total of bytes copied between matrices (see getBytesCopied)
+    static std::atomic<size_t> bytesCopied;
+
 public:
     // Default constructor
     Matrix();
@@ -37,9 +65,36 @@ public:
     */
     Matrix &operator=(const Matrix &other);
 
+    /* Move Constructor
+    ** @param other: matrix object to move from (takes ownership of its buffer, leaving it empty)
+    */
+    Matrix(Matrix &&other) noexcept;
+
+    /* Move Assignment Operator
+    ** @param other: matrix object to move from (takes ownership of its buffer, leaving it empty)
+    */
+    Matrix &operator=(Matrix &&other) noexcept;
+
+    /* Expression constructor and assignment (defined in Expr.h, which callers must include to use them)
+    ** @param expression: fused expression to evaluate into this matrix
+    */
+    template <typename E>
+    Matrix(const expr::Expression<E> &expression);
+    template <typename E>
+    Matrix &operator=(const expr::Expression<E> &expression);
+
     // Destructor
     ~Matrix();
 
+    /* Takes ownership of an existing pixel buffer without copying it
+    ** @param buffer: pointer to the first byte of row 0
+    ** @param rows: number of rows
+    ** @param cols: number of columns
+    ** @param stride: number of bytes between the starts of two consecutive rows
+    ** @param release: called with buffer when the matrix no longer needs it
+    */
+    void adopt(uint8_t *buffer, int rows, int cols, int stride, std::function<void(uint8_t *)> release);
+
     /* Input stream operator
     ** @param in: input stream
     ** @param mat: Matrix object to assign
@@ -52,30 +107,62 @@ public:
     */
     friend std::ostream &operator<<(std::ostream &out, const Matrix &mat);
 
-    /* Addition operator
+    /* Addition operator (saturating, sums above 255 are clamped to 255)
     ** @param other: matrix object to add
     ** @return: matrix object with the result of the addition
     */
     Matrix operator+(const Matrix &other) const;
 
-    /* Subtraction operator
+    /* Subtraction operator (saturating, differences below 0 are clamped to 0)
     ** @param other: matrix object to subtract
     ** @return: matrix object with the result of the subtraction
     */
     Matrix operator-(const Matrix &other) const;
 
-    /* Multiplication operator (Cross product)
+    /* Multiplication operator (Cross product, each entry is the mean of its products rescaled to 0-255)
     ** @param other: matrix object to multiply by
     ** @return: matrix object with the result of the multiplication
     */
     Matrix operator*(const Matrix &other) const;
 
+    /* Compound addition (saturating, in place)
+    ** @param other: matrix object to add
+    ** @return: this matrix
+    */
+    Matrix &operator+=(const Matrix &other);
+
+    /* Compound subtraction (saturating, in place)
+    ** @param other: matrix object to subtract
+    ** @return: this matrix
+    */
+    Matrix &operator-=(const Matrix &other);
+
+    /* Compound scaling (in place)
+    ** @param scalar: multiplier in [0, 1]
+    ** @return: this matrix
+    */
+    Matrix &operator*=(double scalar);
+
     /* Subscript operator
-    ** @param index: index of the element to access
-    ** @return: element at the specified index
+    ** @param index: index of the row to access
+    ** @return: view over the row at the specified index
+    */
+    RowView<uint8_t> operator[](int index);
+    RowView<const uint8_t> operator[](int index) const;
+
+    /* Raw row pointer (no bounds check)
+    ** @param index: index of the row to access
+    ** @return: pointer to the first byte of the row
     */
-    Vector<uint8_t> &operator[](int index);
-    const Vector<uint8_t> &operator[](int index) const;
+    uint8_t *row(int index) { return data + static_cast<size_t>(index) * stride; }
+    const uint8_t *row(int index) const { return data + static_cast<size_t>(index) * stride; }
+
+    // Pointer to the first byte of the pixel buffer
+    uint8_t *getData();
+    const uint8_t *getData() const;
+
+    // Number of bytes between the starts of two consecutive rows
+    int getStride() const;
 
     // Number of rows
     int getRows() const;
@@ -83,6 +170,12 @@ public:
     // Number of columns
     int getCols() const;
 
+    // Total number of pixel bytes copied by Matrix copy constructors and copy assignments
+    static size_t getBytesCopied();
+
+    // Resets the copied byte counter to zero
+    static void resetBytesCopied();
+
     // Transpose function (in-place)
     void transpose();
 };
@@ -0,0 +1,156 @@
+// Pipeline.cpp
+
+#include "Pipeline.h"
+#include "StageTimer.h"
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // Removes leading and trailing whitespace
+    std::string trim(const std::string &text)
+    {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos)
+        {
+            return "";
+        }
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    // Parses a numeric stage argument
+    double parseNumber(const std::string &op, const std::string &text)
+    {
+        size_t used = 0;
+        double value = 0.0;
+        try
+        {
+            value = std::stod(text, &used);
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (used == 0 || used != text.size())
+        {
+            throw std::invalid_argument("Error (Pipeline.cpp_" + op + "): invalid number " + text);
+        }
+        return value;
+    }
+}
+
+Pipeline::Pipeline(const std::string &spec)
+{
+    std::stringstream specStream(spec);
+    std::string part;
+    while (std::getline(specStream, part, '|'))
+    {
+        // Splits the stage into its operation and arguments
+        std::istringstream words(trim(part));
+        Stage stage;
+        std::vector<std::string> args;
+        words >> stage.op;
+        for (std::string word; words >> word;)
+        {
+            args.push_back(word);
+        }
+
+        if (stage.op.empty())
+        {
+            throw std::invalid_argument("Error (Pipeline.cpp_Pipeline): empty stage in " + spec);
+        }
+
+        if (stage.op == "resize" && (args.size() == 1 || args.size() == 2))
+        {
+            for (const std::string &arg : args)
+            {
+                stage.values.push_back(parseNumber(stage.op, arg));
+            }
+        }
+        else if (stage.op == "scale" && args.size() == 1)
+        {
+            stage.values.push_back(parseNumber(stage.op, args[0]));
+            if (stage.values[0] < 0.0 || stage.values[0] > 1.0)
+            {
+                throw std::invalid_argument("Error (Pipeline.cpp_scale): factor out of range");
+            }
+        }
+        else if ((stage.op == "add" || stage.op == "subtract" || stage.op == "dot") && args.size() == 1)
+        {
+            stage.operand = std::make_shared<const Image>(args[0]);
+        }
+        else if (stage.op == "blend" && args.size() == 2)
+        {
+            stage.operand = std::make_shared<const Image>(args[0]);
+            stage.values.push_back(parseNumber(stage.op, args[1]));
+            if (stage.values[0] < 0.0 || stage.values[0] > 1.0)
+            {
+                throw std::invalid_argument("Error (Pipeline.cpp_blend): alpha out of range");
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Error (Pipeline.cpp_Pipeline): invalid stage '" + trim(part) + "'");
+        }
+
+        stages.push_back(std::move(stage));
+    }
+
+    if (stages.empty())
+    {
+        throw std::invalid_argument("Error (Pipeline.cpp_Pipeline): no stages");
+    }
+}
+
+void Pipeline::run(Image &image) const
+{
+    for (const Stage &stage : stages)
+    {
+        StageTimer timer("pipe." + stage.op);
+
+        if (stage.op == "resize")
+        {
+            // One value is a factor for both dimensions, two are the new width and height
+            int newWidth, newHeight;
+            if (stage.values.size() == 1)
+            {
+                newWidth = static_cast<int>(image.getWidth() * stage.values[0]);
+                newHeight = static_cast<int>(image.getHeight() * stage.values[0]);
+            }
+            else
+            {
+                newWidth = static_cast<int>(stage.values[0]);
+                newHeight = static_cast<int>(stage.values[1]);
+            }
+            image.resize(newWidth, newHeight);
+        }
+        else if (stage.op == "scale")
+        {
+            image *= stage.values[0];
+        }
+        else if (stage.op == "add")
+        {
+            image += *stage.operand;
+        }
+        else if (stage.op == "subtract")
+        {
+            image -= *stage.operand;
+        }
+        else if (stage.op == "blend")
+        {
+            Image::blendInto(image, image, *stage.operand, stage.values[0]);
+        }
+        else if (stage.op == "dot")
+        {
+            // The product has different dimensions, so it needs a new buffer
+            image = image * *stage.operand;
+        }
+    }
+}
+
+size_t Pipeline::size() const
+{
+    return stages.size();
+}
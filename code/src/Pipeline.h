@@ -0,0 +1,52 @@
+// Pipeline.h
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Image.h"
+
+// A chain of image operations, e.g. "resize 0.5 | scale 0.8 | add other.png", applied in
+// memory one stage after another so nothing is encoded or decoded between stages.
+//
+// Stages:
+//   resize <factor>            resizes both dimensions by factor (geometry)
+//   resize <width> <height>    resizes to the given dimensions
+//   scale <factor>             multiplies every pixel by factor in [0, 1] (brightness)
+//   add <file>                 averaging blend with another image
+//   subtract <file>            saturating subtraction of another image
+//   blend <file> <alpha>       weighted blend: image * alpha + file * (1 - alpha)
+//   dot <file>                 per-channel matrix product with another image
+class Pipeline
+{
+private:
+    // One parsed stage: operation name, numeric arguments and the operand image (if any)
+    struct Stage
+    {
+        std::string op;
+        std::vector<double> values;
+        std::shared_ptr<const Image> operand;
+    };
+
+    std::vector<Stage> stages;
+
+public:
+    /* Constructor (parses the stages and loads every operand image once)
+    ** @param spec: stages separated by '|'
+    ** Throws std::invalid_argument for an unknown operation or malformed arguments.
+    */
+    explicit Pipeline(const std::string &spec);
+
+    /* Runs every stage on an image, in order (the image is modified in place where possible)
+    ** Safe to call from several threads at once on different images.
+    ** @param image: input image, replaced by the result
+    */
+    void run(Image &image) const;
+
+    // Number of stages
+    size_t size() const;
+};
+
+#endif // PIPELINE_H
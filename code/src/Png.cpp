@@ -0,0 +1,599 @@
+// Png.cpp
+
+#include "Png.h"
+#include "FileIO.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    std::atomic<png::Effort> effortLevel(png::Effort::best);
+
+    // Uncompressed bytes per row group (each group is filtered and deflated by one task)
+    const size_t GROUP_BYTES = 512 * 1024;
+
+    // Largest IDAT chunk written
+    const size_t MAX_CHUNK = 1 << 30;
+
+    const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    // PNG row filter types
+    const uint8_t FILTER_NONE = 0;
+    const uint8_t FILTER_SUB = 1;
+    const uint8_t FILTER_UP = 2;
+
+    // Deflate limits
+    const size_t MAX_STORED = 65535;
+    const int MIN_MATCH = 4;
+    const int MAX_MATCH = 258;
+    const int WINDOW = 32768;
+    const int HASH_BITS = 15;
+
+    const uint32_t ADLER_BASE = 65521;
+
+    // CRC-32 tables for slicing by 8 bytes
+    struct CrcTables
+    {
+        uint32_t table[8][256];
+
+        CrcTables()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                {
+                    c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                for (int t = 1; t < 8; t++)
+                {
+                    table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xff];
+                }
+            }
+        }
+    };
+
+    const CrcTables &crcTables()
+    {
+        static const CrcTables tables;
+        return tables;
+    }
+
+    // Fixed-Huffman codes, bit-reversed so they can be written least significant bit first
+    struct HuffmanTables
+    {
+        // Literal/length symbols 0-287: code and length in bits
+        uint16_t literalCode[288];
+        uint8_t literalBits[288];
+
+        // Match lengths 3-258: length symbol code and extra bits combined
+        uint32_t lengthCode[MAX_MATCH + 1];
+        uint8_t lengthBits[MAX_MATCH + 1];
+
+        // Distance symbols 0-29: reversed 5-bit codes
+        uint8_t distanceCode[30];
+
+        static uint32_t reverse(uint32_t code, int bits)
+        {
+            uint32_t reversed = 0;
+            for (int i = 0; i < bits; i++)
+            {
+                reversed = reversed << 1 | ((code >> i) & 1);
+            }
+            return reversed;
+        }
+
+        HuffmanTables()
+        {
+            for (int symbol = 0; symbol < 288; symbol++)
+            {
+                int bits = symbol < 144 ? 8 : symbol < 256 ? 9
+                                          : symbol < 280   ? 7
+                                                           : 8;
+                uint32_t code = symbol < 144 ? 0x30 + symbol : symbol < 256 ? 0x190 + symbol - 144
+                                                           : symbol < 280   ? symbol - 256
+                                                                            : 0xc0 + symbol - 280;
+                literalCode[symbol] = static_cast<uint16_t>(reverse(code, bits));
+                literalBits[symbol] = static_cast<uint8_t>(bits);
+            }
+
+            static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            for (int index = 0; index < 29; index++)
+            {
+                // 258 has a symbol of its own, so the last 5-extra-bit range stops at 257
+                int last = index == 28 ? MAX_MATCH : lengthBase[index + 1] - 1;
+                for (int length = lengthBase[index]; length <= last; length++)
+                {
+                    int symbol = 257 + index;
+                    lengthCode[length] = literalCode[symbol] | static_cast<uint32_t>(length - lengthBase[index]) << literalBits[symbol];
+                    lengthBits[length] = static_cast<uint8_t>(literalBits[symbol] + lengthExtra[index]);
+                }
+            }
+
+            for (int symbol = 0; symbol < 30; symbol++)
+            {
+                distanceCode[symbol] = static_cast<uint8_t>(reverse(symbol, 5));
+            }
+        }
+    };
+
+    const HuffmanTables &huffmanTables()
+    {
+        static const HuffmanTables tables;
+        return tables;
+    }
+
+    // Writes bits least significant first into a byte buffer sized by the caller
+    class BitWriter
+    {
+    private:
+        uint8_t *out;
+        uint64_t buffer;
+        int count;
+
+    public:
+        explicit BitWriter(uint8_t *out) : out(out), buffer(0), count(0) {}
+
+        // Adds up to 32 bits
+        void put(uint32_t bits, int bitCount)
+        {
+            buffer |= static_cast<uint64_t>(bits) << count;
+            count += bitCount;
+            if (count >= 32)
+            {
+                out[0] = static_cast<uint8_t>(buffer);
+                out[1] = static_cast<uint8_t>(buffer >> 8);
+                out[2] = static_cast<uint8_t>(buffer >> 16);
+                out[3] = static_cast<uint8_t>(buffer >> 24);
+                out += 4;
+                buffer >>= 32;
+                count -= 32;
+            }
+        }
+
+        // Pads with zero bits to a byte boundary and writes out what is left
+        uint8_t *finish()
+        {
+            while (count > 0)
+            {
+                *out++ = static_cast<uint8_t>(buffer);
+                buffer >>= 8;
+                count -= 8;
+            }
+            buffer = 0;
+            count = 0;
+            return out;
+        }
+    };
+
+    // Fixed-Huffman symbol writer
+    class FixedHuffman
+    {
+    private:
+        const HuffmanTables &tables;
+        BitWriter bits;
+
+    public:
+        explicit FixedHuffman(uint8_t *out) : tables(huffmanTables()), bits(out) {}
+
+        // Block header: BFINAL and BTYPE 01 (fixed Huffman)
+        void begin(bool final)
+        {
+            bits.put(final ? 3 : 2, 3);
+        }
+
+        void literal(uint8_t byte)
+        {
+            bits.put(tables.literalCode[byte], tables.literalBits[byte]);
+        }
+
+        void match(int length, int distance)
+        {
+            bits.put(tables.lengthCode[length], tables.lengthBits[length]);
+
+            // Distance symbol from the position of the highest set bit of distance - 1
+            int symbol, extraBits;
+            uint32_t offset = static_cast<uint32_t>(distance - 1);
+            if (offset < 4)
+            {
+                symbol = static_cast<int>(offset);
+                extraBits = 0;
+            }
+            else
+            {
+                int high = 31 - __builtin_clz(offset);
+                symbol = 2 * high + static_cast<int>((offset >> (high - 1)) & 1);
+                extraBits = high - 1;
+            }
+            uint32_t extra = offset & ((1u << extraBits) - 1);
+            bits.put(tables.distanceCode[symbol] | extra << 5, 5 + extraBits);
+        }
+
+        // Ends the block; a non-final block is followed by an empty stored block so the stream
+        // ends on a byte boundary and the next group's blocks can simply be appended
+        uint8_t *end(bool final)
+        {
+            bits.put(tables.literalCode[256], tables.literalBits[256]);
+            if (!final)
+            {
+                bits.put(0, 3);
+                uint8_t *out = bits.finish();
+                const uint8_t emptyStored[4] = {0x00, 0x00, 0xff, 0xff};
+                std::memcpy(out, emptyStored, sizeof(emptyStored));
+                return out + sizeof(emptyStored);
+            }
+            return bits.finish();
+        }
+    };
+
+    // Length of the common prefix of a and b, up to limit bytes
+    inline int matchLength(const uint8_t *a, const uint8_t *b, int limit)
+    {
+        int length = 0;
+        while (length + 8 <= limit)
+        {
+            uint64_t x, y;
+            std::memcpy(&x, a + length, 8);
+            std::memcpy(&y, b + length, 8);
+            if (x != y)
+            {
+                return length + __builtin_ctzll(x ^ y) / 8;
+            }
+            length += 8;
+        }
+        while (length < limit && a[length] == b[length])
+        {
+            length++;
+        }
+        return length;
+    }
+
+    // Deflates data as stored blocks
+    uint8_t *deflateStored(const uint8_t *data, size_t size, bool final, uint8_t *out)
+    {
+        do
+        {
+            size_t length = size < MAX_STORED ? size : MAX_STORED;
+            size -= length;
+            *out++ = final && size == 0 ? 1 : 0;
+            out[0] = static_cast<uint8_t>(length);
+            out[1] = static_cast<uint8_t>(length >> 8);
+            out[2] = static_cast<uint8_t>(~length);
+            out[3] = static_cast<uint8_t>(~length >> 8);
+            std::memcpy(out + 4, data, length);
+            out += 4 + length;
+            data += length;
+        } while (size > 0);
+        return out;
+    }
+
+    // Deflates data as one fixed-Huffman block using only runs of the previous byte (distance 1)
+    uint8_t *deflateRle(const uint8_t *data, size_t size, bool final, uint8_t *out)
+    {
+        FixedHuffman writer(out);
+        writer.begin(final);
+
+        size_t i = 0;
+        if (size > 0)
+        {
+            writer.literal(data[i++]);
+        }
+        while (i < size)
+        {
+            int limit = size - i < static_cast<size_t>(MAX_MATCH) ? static_cast<int>(size - i) : MAX_MATCH;
+            int length = matchLength(data + i, data + i - 1, limit);
+            if (length >= 3)
+            {
+                writer.match(length, 1);
+                i += length;
+            }
+            else
+            {
+                writer.literal(data[i++]);
+            }
+        }
+        return writer.end(final);
+    }
+
+    // Deflates data as one fixed-Huffman block with a greedy LZ77 search (one candidate per hash)
+    uint8_t *deflateFast(const uint8_t *data, size_t size, bool final, uint8_t *out)
+    {
+        thread_local std::vector<int32_t> head;
+        head.assign(static_cast<size_t>(1) << HASH_BITS, -WINDOW - 1);
+
+        FixedHuffman writer(out);
+        writer.begin(final);
+
+        size_t i = 0;
+        while (i + MIN_MATCH <= size)
+        {
+            uint32_t word;
+            std::memcpy(&word, data + i, 4);
+            uint32_t slot = (word * 2654435761u) >> (32 - HASH_BITS);
+            int32_t candidate = head[slot];
+            head[slot] = static_cast<int32_t>(i);
+
+            int distance = static_cast<int>(i) - candidate;
+            if (distance <= WINDOW)
+            {
+                int limit = size - i < static_cast<size_t>(MAX_MATCH) ? static_cast<int>(size - i) : MAX_MATCH;
+                int length = matchLength(data + i, data + candidate, limit);
+                if (length >= MIN_MATCH)
+                {
+                    writer.match(length, distance);
+                    i += length;
+                    continue;
+                }
+            }
+            writer.literal(data[i++]);
+        }
+        while (i < size)
+        {
+            writer.literal(data[i++]);
+        }
+        return writer.end(final);
+    }
+
+    // Combines the Adler-32 of two pieces of data into the checksum of both (as zlib's adler32_combine)
+    uint32_t combineAdler(uint32_t first, uint32_t second, size_t secondLength)
+    {
+        uint64_t remainder = secondLength % ADLER_BASE;
+        uint64_t sum1 = first & 0xffff;
+        uint64_t sum2 = remainder * sum1 % ADLER_BASE;
+        sum1 += (second & 0xffff) + ADLER_BASE - 1;
+        sum2 += (first >> 16) + (second >> 16) + ADLER_BASE - remainder;
+        sum1 %= ADLER_BASE;
+        sum2 %= ADLER_BASE;
+        return static_cast<uint32_t>(sum2 << 16 | sum1);
+    }
+
+    void putBigEndian(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Appends a chunk: length, type, data and the CRC of type and data
+    void putChunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size)
+    {
+        putBigEndian(out, static_cast<uint32_t>(size));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        putBigEndian(out, png::crc32(0, out.data() + start, size + 4));
+    }
+
+    // Filters one row (bpp = bytes per pixel, previous = the unfiltered row above or null)
+    void filterRow(uint8_t filter, const uint8_t *row, const uint8_t *previous, size_t rowBytes, int bpp, uint8_t *out)
+    {
+        out[0] = filter;
+        out++;
+        if (filter == FILTER_SUB)
+        {
+            for (int i = 0; i < bpp && i < static_cast<int>(rowBytes); i++)
+            {
+                out[i] = row[i];
+            }
+            for (size_t i = bpp; i < rowBytes; i++)
+            {
+                out[i] = static_cast<uint8_t>(row[i] - row[i - bpp]);
+            }
+        }
+        else if (filter == FILTER_UP && previous != nullptr)
+        {
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                out[i] = static_cast<uint8_t>(row[i] - previous[i]);
+            }
+        }
+        else
+        {
+            std::memcpy(out, row, rowBytes);
+        }
+    }
+}
+
+void png::setEffort(Effort effort)
+{
+    effortLevel = effort;
+}
+
+png::Effort png::getEffort()
+{
+    return effortLevel;
+}
+
+png::Effort png::parseEffort(const std::string &name)
+{
+    if (name == "stored" || name == "0")
+    {
+        return Effort::stored;
+    }
+    if (name == "rle" || name == "1")
+    {
+        return Effort::rle;
+    }
+    if (name == "fast" || name == "2")
+    {
+        return Effort::fast;
+    }
+    if (name == "best" || name == "3")
+    {
+        return Effort::best;
+    }
+    throw std::invalid_argument("Error (Png.cpp_parseEffort): unknown effort " + name);
+}
+
+uint32_t png::crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    const CrcTables &tables = crcTables();
+    crc = ~crc;
+
+    // Eight bytes per step: each byte of the step is looked up in its own table
+    while (size >= 8)
+    {
+        uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                              static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+        crc = tables.table[7][low & 0xff] ^ tables.table[6][(low >> 8) & 0xff] ^
+              tables.table[5][(low >> 16) & 0xff] ^ tables.table[4][low >> 24] ^
+              tables.table[3][data[4]] ^ tables.table[2][data[5]] ^
+              tables.table[1][data[6]] ^ tables.table[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0)
+    {
+        crc = tables.table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t png::adler32(uint32_t adler, const uint8_t *data, size_t size)
+{
+    uint32_t sum1 = adler & 0xffff;
+    uint32_t sum2 = adler >> 16;
+
+    // 5552 is the most bytes that can be summed before sum2 could overflow 32 bits
+    while (size > 0)
+    {
+        size_t block = size < 5552 ? size : 5552;
+        size -= block;
+        for (size_t i = 0; i < block; i++)
+        {
+            sum1 += data[i];
+            sum2 += sum1;
+        }
+        data += block;
+        sum1 %= ADLER_BASE;
+        sum2 %= ADLER_BASE;
+    }
+    return sum2 << 16 | sum1;
+}
+
+std::vector<uint8_t> png::encode(const uint8_t *pixels, int width, int height, int channels, size_t stride, Effort effort)
+{
+    if (effort == Effort::best)
+    {
+        throw std::invalid_argument("Error (Png.cpp_encode): the best effort level is stb_image_write's encoder");
+    }
+    if (channels < 1 || channels > 4 || width <= 0 || height <= 0)
+    {
+        throw std::invalid_argument("Error (Png.cpp_encode): invalid dimensions");
+    }
+
+    // Color types for 1 to 4 channels: gray, gray and alpha, RGB, RGBA
+    static const uint8_t colorTypes[4] = {0, 4, 2, 6};
+    uint8_t filter = effort == Effort::stored ? FILTER_NONE : effort == Effort::rle ? FILTER_SUB
+                                                                                    : FILTER_UP;
+
+    size_t rowBytes = static_cast<size_t>(width) * channels;
+    int groupRows = static_cast<int>(GROUP_BYTES / (rowBytes + 1));
+    groupRows = groupRows > 0 ? groupRows : 1;
+    int groups = (height + groupRows - 1) / groupRows;
+
+    // Each group is filtered and deflated on its own; its output buffer is sized for the worst case
+    // (stored block overhead, or 9 bits per literal plus the block header and trailing empty block)
+    struct Group
+    {
+        std::vector<uint8_t> deflated;
+        size_t size;
+        uint32_t adler;
+    };
+    std::vector<Group> results(groups);
+
+    ThreadPool::shared().parallelFor(groups, [&](int group)
+                                     {
+        int first = group * groupRows;
+        int last = first + groupRows < height ? first + groupRows : height;
+        bool final = group == groups - 1;
+
+        thread_local std::vector<uint8_t> filtered;
+        filtered.resize((last - first) * (rowBytes + 1));
+        for (int y = first; y < last; y++)
+        {
+            const uint8_t *row = pixels + y * stride;
+            const uint8_t *previous = y > 0 ? row - stride : nullptr;
+            filterRow(filter, row, previous, rowBytes, channels, filtered.data() + (y - first) * (rowBytes + 1));
+        }
+
+        Group &result = results[group];
+        result.size = filtered.size();
+        result.adler = png::adler32(1, filtered.data(), filtered.size());
+        result.deflated.resize(filtered.size() + filtered.size() / 8 + (filtered.size() / MAX_STORED + 1) * 5 + 16);
+
+        uint8_t *begin = result.deflated.data();
+        uint8_t *end;
+        if (effort == Effort::stored)
+        {
+            end = deflateStored(filtered.data(), filtered.size(), final, begin);
+        }
+        else if (effort == Effort::rle)
+        {
+            end = deflateRle(filtered.data(), filtered.size(), final, begin);
+        }
+        else
+        {
+            end = deflateFast(filtered.data(), filtered.size(), final, begin);
+        }
+        result.deflated.resize(end - begin); });
+
+    // zlib stream: header (deflate, 32K window, fastest), the groups in order, Adler-32 of all filtered rows
+    std::vector<uint8_t> stream = {0x78, 0x01};
+    uint32_t adler = 1;
+    for (const Group &group : results)
+    {
+        stream.insert(stream.end(), group.deflated.begin(), group.deflated.end());
+        adler = combineAdler(adler, group.adler, group.size);
+    }
+    putBigEndian(stream, adler);
+
+    std::vector<uint8_t> file(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+    file.reserve(stream.size() + 64);
+
+    uint8_t header[13];
+    header[0] = static_cast<uint8_t>(width >> 24);
+    header[1] = static_cast<uint8_t>(width >> 16);
+    header[2] = static_cast<uint8_t>(width >> 8);
+    header[3] = static_cast<uint8_t>(width);
+    header[4] = static_cast<uint8_t>(height >> 24);
+    header[5] = static_cast<uint8_t>(height >> 16);
+    header[6] = static_cast<uint8_t>(height >> 8);
+    header[7] = static_cast<uint8_t>(height);
+    header[8] = 8; // bits per sample
+    header[9] = colorTypes[channels - 1];
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering (one filter type byte per row)
+    header[12] = 0; // not interlaced
+    putChunk(file, "IHDR", header, sizeof(header));
+
+    for (size_t offset = 0; offset < stream.size(); offset += MAX_CHUNK)
+    {
+        size_t size = stream.size() - offset < MAX_CHUNK ? stream.size() - offset : MAX_CHUNK;
+        putChunk(file, "IDAT", stream.data() + offset, size);
+    }
+    putChunk(file, "IEND", nullptr, 0);
+
+    return file;
+}
+
+void png::write(const std::string &path, const uint8_t *pixels, int width, int height, int channels, size_t stride, Effort effort)
+{
+    std::vector<uint8_t> encoded = encode(pixels, width, height, channels, stride, effort);
+
+    // Replaces the target in one step (see FileIO.h)
+    fileio::ReplacementFile file(path);
+    if (!file.get() || std::fwrite(encoded.data(), 1, encoded.size(), file.get()) != encoded.size() || !file.commit())
+    {
+        throw std::runtime_error("Error (Png.cpp_write): could not write " + path);
+    }
+}
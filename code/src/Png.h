@@ -0,0 +1,74 @@
+// Png.h
+
+#ifndef PNG_H
+#define PNG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// PNG encoder with a compression effort knob, for when write latency matters more than file size.
+// The image is cut into groups of rows that are filtered and deflated independently on the shared
+// thread pool, then joined into one zlib stream (each group but the last ends in an empty stored
+// block, which byte-aligns it) inside a single valid PNG. Effort levels:
+//   stored  no filter, stored (uncompressed) deflate blocks
+//   rle     Sub filter, fixed-Huffman deflate with distance-1 runs only
+//   fast    Up filter, fixed-Huffman deflate with a greedy single-probe LZ77 match search
+//   best    stb_image_write's encoder (default; smallest files, one thread)
+namespace png
+{
+    enum class Effort
+    {
+        stored,
+        rle,
+        fast,
+        best
+    };
+
+    /* Sets the effort used by Image::save for every following PNG
+    ** @param effort: effort level
+    */
+    void setEffort(Effort effort);
+
+    // Current effort level
+    Effort getEffort();
+
+    /* Parses an effort level name (stored, rle, fast or best) or number (0 to 3)
+    ** @param name: level name or number
+    ** @return: effort level (throws std::invalid_argument for an unknown name)
+    */
+    Effort parseEffort(const std::string &name);
+
+    /* Encodes an image as PNG with one of this encoder's levels (stored, rle or fast)
+    ** @param pixels: first pixel of the image
+    ** @param width, height: image dimensions
+    ** @param channels: 1 to 4 (gray, gray and alpha, RGB, RGBA)
+    ** @param stride: bytes between rows of pixels
+    ** @param effort: stored, rle or fast (throws std::invalid_argument for best)
+    ** @return: the PNG file
+    */
+    std::vector<uint8_t> encode(const uint8_t *pixels, int width, int height, int channels, size_t stride, Effort effort);
+
+    /* Encodes an image and writes it to a file
+    ** @param path: output file (throws std::runtime_error if it cannot be written)
+    ** @param pixels, width, height, channels, stride, effort: as for encode
+    */
+    void write(const std::string &path, const uint8_t *pixels, int width, int height, int channels, size_t stride, Effort effort);
+
+    /* CRC-32 (as used by PNG chunks and gzip)
+    ** @param crc: CRC of the preceding data (0 to start)
+    ** @param data, size: bytes to add
+    ** @return: updated CRC
+    */
+    uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size);
+
+    /* Adler-32 (as used by zlib streams)
+    ** @param adler: checksum of the preceding data (1 to start)
+    ** @param data, size: bytes to add
+    ** @return: updated checksum
+    */
+    uint32_t adler32(uint32_t adler, const uint8_t *data, size_t size);
+}
+
+#endif // PNG_H
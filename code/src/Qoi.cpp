@@ -0,0 +1,339 @@
+// Qoi.cpp
+
+#include "Qoi.h"
+#include "FileIO.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const uint8_t OP_INDEX = 0x00; // 00xxxxxx: pixel from the index
+    const uint8_t OP_DIFF = 0x40;  // 01rrggbb: small difference from the previous pixel
+    const uint8_t OP_LUMA = 0x80;  // 10gggggg rrrrbbbb: green difference, then red and blue relative to it
+    const uint8_t OP_RUN = 0xc0;   // 11xxxxxx: previous pixel repeated 1 to 62 times
+    const uint8_t OP_RGB = 0xfe;
+    const uint8_t OP_RGBA = 0xff;
+
+    const size_t HEADER_SIZE = 14;
+    const uint8_t END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    const int MAX_RUN = 62;
+
+    // Largest image the format allows (guards the size computations below)
+    const size_t MAX_PIXELS = 400000000;
+
+    // A pixel packed as r | g << 8 | b << 16 | a << 24, so whole pixels compare as one integer
+    inline uint32_t pack(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+    {
+        return static_cast<uint32_t>(r) | static_cast<uint32_t>(g) << 8 | static_cast<uint32_t>(b) << 16 | static_cast<uint32_t>(a) << 24;
+    }
+
+    inline uint8_t red(uint32_t px) { return static_cast<uint8_t>(px); }
+    inline uint8_t green(uint32_t px) { return static_cast<uint8_t>(px >> 8); }
+    inline uint8_t blue(uint32_t px) { return static_cast<uint8_t>(px >> 16); }
+    inline uint8_t alpha(uint32_t px) { return static_cast<uint8_t>(px >> 24); }
+
+    // Index slot of a pixel: (r * 3 + g * 5 + b * 7 + a * 11) % 64
+    inline uint8_t hash(uint32_t px)
+    {
+        return static_cast<uint8_t>((red(px) * 3 + green(px) * 5 + blue(px) * 7 + alpha(px) * 11) & 63);
+    }
+
+    inline void writeBigEndian(uint8_t *bytes, uint32_t value)
+    {
+        bytes[0] = static_cast<uint8_t>(value >> 24);
+        bytes[1] = static_cast<uint8_t>(value >> 16);
+        bytes[2] = static_cast<uint8_t>(value >> 8);
+        bytes[3] = static_cast<uint8_t>(value);
+    }
+
+    inline uint32_t readBigEndian(const uint8_t *bytes)
+    {
+        return static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+    }
+
+    // Packs a row of 3- or 4-channel pixels (3-channel pixels get an alpha of 255)
+    template <int Channels>
+    void packRow(const uint8_t *in, uint32_t *out, int width)
+    {
+        for (int x = 0; x < width; x++, in += Channels)
+        {
+            out[x] = pack(in[0], in[1], in[2], Channels == 4 ? in[3] : 255);
+        }
+    }
+
+    // Number of pixels from row[x] on (up to width) that equal px; runs of identical pixels are
+    // common in flat regions, so they are compared four at a time
+    int countRun(const uint32_t *row, int x, int width, uint32_t px)
+    {
+        int start = x;
+#if defined(__SSE2__)
+        __m128i target = _mm_set1_epi32(static_cast<int>(px));
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+            int equal = _mm_movemask_epi8(_mm_cmpeq_epi32(pixels, target));
+            if (equal != 0xffff)
+            {
+                return x - start + __builtin_ctz(~equal) / 4;
+            }
+        }
+#endif
+        while (x < width && row[x] == px)
+        {
+            x++;
+        }
+        return x - start;
+    }
+
+    // Decodes every pixel into Channels bytes each
+    template <int Channels>
+    void decodeRows(const uint8_t *bytes, size_t size, uint8_t *pixels, size_t stride, int width, int height)
+    {
+        uint32_t index[64] = {};
+        uint32_t px = pack(0, 0, 0, 255);
+        size_t pos = HEADER_SIZE;
+        size_t end = size - sizeof(END_MARKER);
+        int run = 0;
+
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t *out = pixels + y * stride;
+            for (int x = 0; x < width; x++, out += Channels)
+            {
+                if (run > 0)
+                {
+                    run--;
+                }
+                else
+                {
+                    if (pos >= end)
+                    {
+                        throw std::runtime_error("Error (Qoi.cpp_decode): truncated data");
+                    }
+
+                    uint8_t op = bytes[pos++];
+                    if (op == OP_RGB || op == OP_RGBA)
+                    {
+                        size_t length = op == OP_RGB ? 3 : 4;
+                        if (end - pos < length)
+                        {
+                            throw std::runtime_error("Error (Qoi.cpp_decode): truncated data");
+                        }
+                        px = pack(bytes[pos], bytes[pos + 1], bytes[pos + 2], op == OP_RGB ? alpha(px) : bytes[pos + 3]);
+                        pos += length;
+                    }
+                    else if ((op & 0xc0) == OP_INDEX)
+                    {
+                        px = index[op];
+                    }
+                    else if ((op & 0xc0) == OP_DIFF)
+                    {
+                        px = pack(red(px) + ((op >> 4) & 3) - 2, green(px) + ((op >> 2) & 3) - 2, blue(px) + (op & 3) - 2, alpha(px));
+                    }
+                    else if ((op & 0xc0) == OP_LUMA)
+                    {
+                        if (pos >= end)
+                        {
+                            throw std::runtime_error("Error (Qoi.cpp_decode): truncated data");
+                        }
+                        uint8_t next = bytes[pos++];
+                        int dg = (op & 0x3f) - 32;
+                        px = pack(red(px) + dg - 8 + (next >> 4), green(px) + dg, blue(px) + dg - 8 + (next & 0x0f), alpha(px));
+                    }
+                    else
+                    {
+                        run = op & 0x3f;
+                    }
+                    index[hash(px)] = px;
+                }
+
+                out[0] = red(px);
+                out[1] = green(px);
+                out[2] = blue(px);
+                if (Channels == 4)
+                {
+                    out[3] = alpha(px);
+                }
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> qoi::encode(const uint8_t *pixels, int width, int height, int channels, size_t stride)
+{
+    if (channels != 3 && channels != 4)
+    {
+        throw std::invalid_argument("Error (Qoi.cpp_encode): QOI supports 3 or 4 channels, the image has " + std::to_string(channels));
+    }
+    if (width <= 0 || height <= 0 || static_cast<size_t>(width) * height > MAX_PIXELS)
+    {
+        throw std::invalid_argument("Error (Qoi.cpp_encode): invalid dimensions");
+    }
+
+    // Worst case: every pixel written as a full RGBA chunk
+    std::vector<uint8_t> encoded(HEADER_SIZE + static_cast<size_t>(width) * height * (channels + 1) + sizeof(END_MARKER));
+    uint8_t *out = encoded.data();
+
+    std::memcpy(out, "qoif", 4);
+    writeBigEndian(out + 4, static_cast<uint32_t>(width));
+    writeBigEndian(out + 8, static_cast<uint32_t>(height));
+    out[12] = static_cast<uint8_t>(channels);
+    out[13] = 0; // sRGB with linear alpha
+    out += HEADER_SIZE;
+
+    uint32_t index[64] = {};
+    uint32_t prev = pack(0, 0, 0, 255);
+    int run = 0;
+
+    // Each row is packed into whole-pixel integers and hashed in separate passes over it, which
+    // keeps those loops branch-free so the compiler can vectorize them
+    std::vector<uint32_t> row(width);
+    std::vector<uint8_t> hashes(width);
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *in = pixels + y * stride;
+        if (channels == 4)
+        {
+            packRow<4>(in, row.data(), width);
+        }
+        else
+        {
+            packRow<3>(in, row.data(), width);
+        }
+        for (int x = 0; x < width; x++)
+        {
+            hashes[x] = hash(row[x]);
+        }
+
+        for (int x = 0; x < width;)
+        {
+            uint32_t px = row[x];
+            if (px == prev)
+            {
+                // Runs continue across rows, and are split into chunks of at most 62
+                int length = countRun(row.data(), x, width, px);
+                x += length;
+                run += length;
+                for (; run >= MAX_RUN; run -= MAX_RUN)
+                {
+                    *out++ = OP_RUN | (MAX_RUN - 1);
+                }
+                continue;
+            }
+
+            if (run > 0)
+            {
+                *out++ = static_cast<uint8_t>(OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            uint8_t slot = hashes[x];
+            if (index[slot] == px)
+            {
+                *out++ = static_cast<uint8_t>(OP_INDEX | slot);
+            }
+            else
+            {
+                index[slot] = px;
+
+                if (alpha(px) == alpha(prev))
+                {
+                    int8_t dr = static_cast<int8_t>(red(px) - red(prev));
+                    int8_t dg = static_cast<int8_t>(green(px) - green(prev));
+                    int8_t db = static_cast<int8_t>(blue(px) - blue(prev));
+                    int8_t drg = static_cast<int8_t>(dr - dg);
+                    int8_t dbg = static_cast<int8_t>(db - dg);
+
+                    if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+                    {
+                        *out++ = static_cast<uint8_t>(OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    }
+                    else if (drg > -9 && drg < 8 && dg > -33 && dg < 32 && dbg > -9 && dbg < 8)
+                    {
+                        *out++ = static_cast<uint8_t>(OP_LUMA | (dg + 32));
+                        *out++ = static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8));
+                    }
+                    else
+                    {
+                        *out++ = OP_RGB;
+                        *out++ = red(px);
+                        *out++ = green(px);
+                        *out++ = blue(px);
+                    }
+                }
+                else
+                {
+                    *out++ = OP_RGBA;
+                    *out++ = red(px);
+                    *out++ = green(px);
+                    *out++ = blue(px);
+                    *out++ = alpha(px);
+                }
+            }
+
+            prev = px;
+            x++;
+        }
+    }
+
+    if (run > 0)
+    {
+        *out++ = static_cast<uint8_t>(OP_RUN | (run - 1));
+    }
+    std::memcpy(out, END_MARKER, sizeof(END_MARKER));
+    out += sizeof(END_MARKER);
+
+    encoded.resize(out - encoded.data());
+    return encoded;
+}
+
+qoi::Header qoi::readHeader(const uint8_t *bytes, size_t size)
+{
+    if (size < HEADER_SIZE + sizeof(END_MARKER) || std::memcmp(bytes, "qoif", 4) != 0)
+    {
+        throw std::runtime_error("Error (Qoi.cpp_readHeader): not a QOI file");
+    }
+
+    uint32_t width = readBigEndian(bytes + 4);
+    uint32_t height = readBigEndian(bytes + 8);
+    Header header;
+    header.channels = bytes[12];
+    if (width == 0 || height == 0 || height >= MAX_PIXELS / width || (header.channels != 3 && header.channels != 4))
+    {
+        throw std::runtime_error("Error (Qoi.cpp_readHeader): invalid dimensions");
+    }
+    header.width = static_cast<int>(width);
+    header.height = static_cast<int>(height);
+    return header;
+}
+
+void qoi::decode(const uint8_t *bytes, size_t size, uint8_t *pixels, size_t stride)
+{
+    Header header = readHeader(bytes, size);
+    if (header.channels == 4)
+    {
+        decodeRows<4>(bytes, size, pixels, stride, header.width, header.height);
+    }
+    else
+    {
+        decodeRows<3>(bytes, size, pixels, stride, header.width, header.height);
+    }
+}
+
+void qoi::write(const std::string &path, const uint8_t *pixels, int width, int height, int channels, size_t stride)
+{
+    std::vector<uint8_t> encoded = encode(pixels, width, height, channels, stride);
+
+    // Replaces the target in one step (see FileIO.h)
+    fileio::ReplacementFile file(path);
+    if (!file.get() || std::fwrite(encoded.data(), 1, encoded.size(), file.get()) != encoded.size() || !file.commit())
+    {
+        throw std::runtime_error("Error (Qoi.cpp_write): could not write " + path);
+    }
+}
@@ -0,0 +1,53 @@
+// Qoi.h
+
+#ifndef QOI_H
+#define QOI_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// "Quite OK Image" codec (https://qoiformat.org): lossless like PNG, but a single pass over the
+// pixels with no entropy coding, so encoding and decoding run at memory speed rather than
+// deflate speed. Supports 3- and 4-channel images.
+namespace qoi
+{
+    // Image dimensions from a QOI header
+    struct Header
+    {
+        int width;
+        int height;
+        int channels;
+    };
+
+    /* Encodes an image
+    ** @param pixels: first pixel of the image
+    ** @param width, height: image dimensions
+    ** @param channels: 3 (RGB) or 4 (RGBA), otherwise throws std::invalid_argument
+    ** @param stride: bytes between rows of pixels
+    ** @return: the encoded file
+    */
+    std::vector<uint8_t> encode(const uint8_t *pixels, int width, int height, int channels, size_t stride);
+
+    /* Reads and checks the header of an encoded file
+    ** @param bytes, size: encoded file (throws std::runtime_error if it is not a valid QOI file)
+    ** @return: image dimensions
+    */
+    Header readHeader(const uint8_t *bytes, size_t size);
+
+    /* Decodes an image into a caller-provided buffer
+    ** @param bytes, size: encoded file (throws std::runtime_error if it is malformed or truncated)
+    ** @param pixels: receives height rows of width * channels bytes (channels from readHeader)
+    ** @param stride: bytes between rows of pixels
+    */
+    void decode(const uint8_t *bytes, size_t size, uint8_t *pixels, size_t stride);
+
+    /* Encodes an image and writes it to a file
+    ** @param path: output file (throws std::runtime_error if it cannot be written)
+    ** @param pixels, width, height, channels, stride: as for encode
+    */
+    void write(const std::string &path, const uint8_t *pixels, int width, int height, int channels, size_t stride);
+}
+
+#endif // QOI_H
@@ -0,0 +1,629 @@
+// Resample.cpp
+
+#include "Resample.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESAMPLE_X86 1
+#include <immintrin.h>
+#else
+#define RESAMPLE_X86 0
+#endif
+
+namespace
+{
+    std::atomic<resample::Filter> currentFilter(resample::Filter::bicubic);
+
+    // Fractional bits of the fixed-point weights, and the rounding term added before shifting them out
+    const int SHIFT = 14;
+    const int ROUND = 1 << (SHIFT - 1);
+
+    // Fewest output rows per strip (each strip filters the input rows under its first output row again)
+    const int MIN_STRIP_ROWS = 64;
+
+    const double PI = 3.14159265358979323846;
+
+    // Radius of a filter in input pixels (before stretching for a downscale)
+    double filterRadius(resample::Filter filter)
+    {
+        switch (filter)
+        {
+        case resample::Filter::box:
+            return 0.5;
+        case resample::Filter::bilinear:
+            return 1.0;
+        case resample::Filter::bicubic:
+            return 2.0;
+        case resample::Filter::lanczos3:
+            return 3.0;
+        default:
+            throw std::invalid_argument("Error (Resample.cpp_filterRadius): stbir has no native filter");
+        }
+    }
+
+    // Weight of an input pixel at distance x (in filter units) from the output pixel's center
+    double filterWeight(resample::Filter filter, double x)
+    {
+        double distance = std::fabs(x);
+        switch (filter)
+        {
+        case resample::Filter::box:
+            // Half-open, so a pixel exactly between two output pixels belongs to one of them
+            return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+        case resample::Filter::bilinear:
+            return distance < 1.0 ? 1.0 - distance : 0.0;
+        case resample::Filter::bicubic:
+            if (distance < 1.0)
+            {
+                return (1.5 * distance - 2.5) * distance * distance + 1.0;
+            }
+            return distance < 2.0 ? ((-0.5 * distance + 2.5) * distance - 4.0) * distance + 2.0 : 0.0;
+        case resample::Filter::lanczos3:
+            if (distance < 1e-8)
+            {
+                return 1.0;
+            }
+            return distance < 3.0 ? 3.0 * std::sin(PI * distance) * std::sin(PI * distance / 3.0) / (PI * PI * distance * distance) : 0.0;
+        default:
+            return 0.0;
+        }
+    }
+
+    // Converts a value shifted back from fixed point to a byte
+    inline uint8_t clampByte(int value)
+    {
+        return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    // Signatures of the horizontal pass (one input row to one output-width row) and the vertical
+    // pass (taps rows combined into one output row of count bytes)
+    typedef void (*HorizontalKernel)(const uint8_t *, uint8_t *, const resample::Axis &, int);
+    typedef void (*VerticalKernel)(const uint8_t *const *, const int16_t *, int, uint8_t *, size_t);
+
+    // Signature of one output row of the exact box downscale (see boxDownscale)
+    typedef void (*BoxRowKernel)(const uint8_t *, size_t, uint8_t *, int, int, int, uint16_t *);
+
+    struct PassKernels
+    {
+        HorizontalKernel horizontal;
+        VerticalKernel vertical;
+        BoxRowKernel boxRow;
+    };
+
+    void horizontalScalar(const uint8_t *in, uint8_t *out, const resample::Axis &axis, int channels)
+    {
+        int taps = axis.taps;
+        for (int x = 0; x < axis.outSize; x++)
+        {
+            const uint8_t *pixels = in + static_cast<size_t>(axis.first[x]) * channels;
+            const int16_t *weights = axis.weights.data() + static_cast<size_t>(x) * taps;
+            for (int c = 0; c < channels; c++)
+            {
+                int sum = ROUND;
+                for (int t = 0; t < taps; t++)
+                {
+                    sum += weights[t] * pixels[t * channels + c];
+                }
+                out[x * channels + c] = clampByte(sum >> SHIFT);
+            }
+        }
+    }
+
+    // Vertical pass over bytes first to count - 1 (the vector kernels use this for their tails)
+    void verticalRange(const uint8_t *const *rows, const int16_t *weights, int taps, uint8_t *out, size_t first, size_t count)
+    {
+        for (size_t i = first; i < count; i++)
+        {
+            int sum = ROUND;
+            for (int t = 0; t < taps; t++)
+            {
+                sum += weights[t] * rows[t][i];
+            }
+            out[i] = clampByte(sum >> SHIFT);
+        }
+    }
+
+    void verticalScalar(const uint8_t *const *rows, const int16_t *weights, int taps, uint8_t *out, size_t count)
+    {
+        verticalRange(rows, weights, taps, out, 0, count);
+    }
+
+    // One output row of a factor x factor box downscale: sums holds the column sums of the factor
+    // input rows (it has room for outputWidth * factor * channels + 4 values)
+    void boxRowScalar(const uint8_t *in, size_t inputStride, uint8_t *out, int outputWidth, int channels, int factor, uint16_t *sums)
+    {
+        size_t bytes = static_cast<size_t>(outputWidth) * factor * channels;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            sums[i] = in[i];
+        }
+        for (int r = 1; r < factor; r++)
+        {
+            const uint8_t *row = in + r * inputStride;
+            for (size_t i = 0; i < bytes; i++)
+            {
+                sums[i] += row[i];
+            }
+        }
+
+        int shift = factor == 2 ? 2 : 4;
+        for (int x = 0; x < outputWidth; x++)
+        {
+            const uint16_t *block = sums + static_cast<size_t>(x) * factor * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                unsigned sum = 1u << (shift - 1);
+                for (int i = 0; i < factor; i++)
+                {
+                    sum += block[i * channels + c];
+                }
+                out[x * channels + c] = static_cast<uint8_t>(sum >> shift);
+            }
+        }
+    }
+
+#if RESAMPLE_X86
+    // Sums the input rows 16 bytes at a time, then adds the factor pixels of each block with one
+    // 4-lane (64-bit) load per pixel, two output pixels per vector (lanes past the channels are ignored)
+    __attribute__((target("sse2"))) void boxRowSse2(const uint8_t *in, size_t inputStride, uint8_t *out, int outputWidth, int channels, int factor, uint16_t *sums)
+    {
+        size_t bytes = static_cast<size_t>(outputWidth) * factor * channels;
+        __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16)
+        {
+            __m128i low = zero, high = zero;
+            for (int r = 0; r < factor; r++)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + r * inputStride + i));
+                low = _mm_add_epi16(low, _mm_unpacklo_epi8(v, zero));
+                high = _mm_add_epi16(high, _mm_unpackhi_epi8(v, zero));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + i), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + i + 8), high);
+        }
+        for (; i < bytes; i++)
+        {
+            unsigned sum = 0;
+            for (int r = 0; r < factor; r++)
+            {
+                sum += in[r * inputStride + i];
+            }
+            sums[i] = static_cast<uint16_t>(sum);
+        }
+
+        int shift = factor == 2 ? 2 : 4;
+        __m128i round = _mm_set1_epi16(static_cast<short>(1 << (shift - 1)));
+        size_t group = static_cast<size_t>(factor) * channels;
+        auto blockSum = [&](const uint16_t *block)
+        {
+            __m128i sum = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(block));
+            for (int p = 1; p < factor; p++)
+            {
+                sum = _mm_add_epi16(sum, _mm_loadl_epi64(reinterpret_cast<const __m128i *>(block + p * channels)));
+            }
+            return sum;
+        };
+        for (int x = 0; x < outputWidth; x += 2)
+        {
+            const uint16_t *block = sums + x * group;
+            __m128i pair = blockSum(block);
+            if (x + 1 < outputWidth)
+            {
+                pair = _mm_unpacklo_epi64(pair, blockSum(block + group));
+            }
+            pair = _mm_srli_epi16(_mm_add_epi16(pair, round), shift);
+            __m128i packed = _mm_packus_epi16(pair, pair);
+            uint32_t first = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+            std::memcpy(out + x * channels, &first, channels);
+            if (x + 1 < outputWidth)
+            {
+                uint32_t second = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 4)));
+                std::memcpy(out + (x + 1) * channels, &second, channels);
+            }
+        }
+    }
+
+    // Byte shuffles that widen two pixels of 1 to 4 channels to 16-bit (first, second) pairs per
+    // channel, ready for a multiply-add with a (w0, w1) weight pair: pairMasks[channels - 1][0] takes
+    // pixels 0 and 1 of a 16-byte load, pairMasks[channels - 1][1] pixels 2 and 3. Index 0x80 writes a zero.
+    alignas(16) const uint8_t pairMasks[4][2][16] = {
+        {{0, 0x80, 1, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {2, 0x80, 3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}},
+        {{0, 0x80, 2, 0x80, 1, 0x80, 3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {4, 0x80, 6, 0x80, 5, 0x80, 7, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}},
+        {{0, 0x80, 3, 0x80, 1, 0x80, 4, 0x80, 2, 0x80, 5, 0x80, 0x80, 0x80, 0x80, 0x80},
+         {6, 0x80, 9, 0x80, 7, 0x80, 10, 0x80, 8, 0x80, 11, 0x80, 0x80, 0x80, 0x80, 0x80}},
+        {{0, 0x80, 4, 0x80, 1, 0x80, 5, 0x80, 2, 0x80, 6, 0x80, 3, 0x80, 7, 0x80},
+         {8, 0x80, 12, 0x80, 9, 0x80, 13, 0x80, 10, 0x80, 14, 0x80, 11, 0x80, 15, 0x80}}};
+
+    // Sum of four taps for one pixel: weights holds w0 to w3 in its low 64 bits
+    __attribute__((target("ssse3"))) inline __m128i fourTaps(__m128i bytes, __m128i weights, __m128i low, __m128i high)
+    {
+        __m128i first = _mm_madd_epi16(_mm_shuffle_epi8(bytes, low), _mm_shuffle_epi32(weights, 0x00));
+        __m128i second = _mm_madd_epi16(_mm_shuffle_epi8(bytes, high), _mm_shuffle_epi32(weights, 0x55));
+        return _mm_add_epi32(first, second);
+    }
+
+    // Shifts the per-channel sums of one pixel out of fixed point and stores its channels bytes
+    __attribute__((target("ssse3"))) inline void storePixel(uint8_t *out, __m128i sums, int channels)
+    {
+        __m128i words = _mm_packs_epi32(_mm_srai_epi32(sums, SHIFT), _mm_setzero_si128());
+        uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(words, words)));
+        std::memcpy(out, &bytes, channels);
+    }
+
+    // Filters one pixel per iteration, four taps at a time (one 16-byte load covers four pixels)
+    __attribute__((target("ssse3"))) void horizontalSsse3(const uint8_t *in, uint8_t *out, const resample::Axis &axis, int channels)
+    {
+        __m128i low = _mm_load_si128(reinterpret_cast<const __m128i *>(pairMasks[channels - 1][0]));
+        __m128i high = _mm_load_si128(reinterpret_cast<const __m128i *>(pairMasks[channels - 1][1]));
+        int taps = axis.taps;
+        for (int x = 0; x < axis.outSize; x++)
+        {
+            const uint8_t *pixels = in + static_cast<size_t>(axis.first[x]) * channels;
+            const int16_t *weights = axis.weights.data() + static_cast<size_t>(x) * taps;
+            __m128i sums = _mm_set1_epi32(ROUND);
+            for (int t = 0; t < taps; t += 4)
+            {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + t * channels));
+                __m128i w = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights + t));
+                sums = _mm_add_epi32(sums, fourTaps(bytes, w, low, high));
+            }
+            storePixel(out + x * channels, sums, channels);
+        }
+    }
+
+    // Filters two pixels per iteration, one in each 128-bit lane, with the same shuffles as SSSE3
+    __attribute__((target("avx2"))) void horizontalAvx2(const uint8_t *in, uint8_t *out, const resample::Axis &axis, int channels)
+    {
+        __m128i low = _mm_load_si128(reinterpret_cast<const __m128i *>(pairMasks[channels - 1][0]));
+        __m128i high = _mm_load_si128(reinterpret_cast<const __m128i *>(pairMasks[channels - 1][1]));
+        __m256i lowPair = _mm256_broadcastsi128_si256(low);
+        __m256i highPair = _mm256_broadcastsi128_si256(high);
+        int taps = axis.taps;
+        int x = 0;
+        for (; x + 2 <= axis.outSize; x += 2)
+        {
+            const uint8_t *pixels0 = in + static_cast<size_t>(axis.first[x]) * channels;
+            const uint8_t *pixels1 = in + static_cast<size_t>(axis.first[x + 1]) * channels;
+            const int16_t *weights0 = axis.weights.data() + static_cast<size_t>(x) * taps;
+            const int16_t *weights1 = weights0 + taps;
+            __m256i sums = _mm256_set1_epi32(ROUND);
+            for (int t = 0; t < taps; t += 4)
+            {
+                __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels0 + t * channels))),
+                                                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels1 + t * channels)), 1);
+                __m256i w = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights0 + t))),
+                                                    _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights1 + t)), 1);
+                __m256i first = _mm256_madd_epi16(_mm256_shuffle_epi8(bytes, lowPair), _mm256_shuffle_epi32(w, 0x00));
+                __m256i second = _mm256_madd_epi16(_mm256_shuffle_epi8(bytes, highPair), _mm256_shuffle_epi32(w, 0x55));
+                sums = _mm256_add_epi32(sums, _mm256_add_epi32(first, second));
+            }
+            storePixel(out + x * channels, _mm256_castsi256_si128(sums), channels);
+            storePixel(out + (x + 1) * channels, _mm256_extracti128_si256(sums, 1), channels);
+        }
+        for (; x < axis.outSize; x++)
+        {
+            const uint8_t *pixels = in + static_cast<size_t>(axis.first[x]) * channels;
+            const int16_t *weights = axis.weights.data() + static_cast<size_t>(x) * taps;
+            __m128i sums = _mm_set1_epi32(ROUND);
+            for (int t = 0; t < taps; t += 4)
+            {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + t * channels));
+                __m128i w = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights + t));
+                sums = _mm_add_epi32(sums, fourTaps(bytes, w, low, high));
+            }
+            storePixel(out + x * channels, sums, channels);
+        }
+    }
+
+    // Two weights as the (w0, w1) pair of 16-bit values a multiply-add expects
+    inline int weightPair(int16_t w0, int16_t w1)
+    {
+        return static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(w1)) << 16) | static_cast<uint16_t>(w0));
+    }
+
+// Defines one vertical pass kernel: WIDTH bytes per iteration, two rows per multiply-add. Bytes of
+// the two rows are interleaved and widened to 16-bit (row t, row t + 1) pairs, giving four vectors of
+// 32-bit sums; the 256-bit unpacks and packs work within 128-bit lanes, so they undo each other.
+#define DEFINE_VERTICAL_KERNEL(NAME, TARGET, VECTOR, WIDTH, P, LOAD, STORE, ZERO)                                  \
+    __attribute__((target(TARGET))) void NAME(const uint8_t *const *rows, const int16_t *weights, int taps, uint8_t *out, size_t count) \
+    {                                                                                                             \
+        VECTOR zero = ZERO();                                                                                     \
+        VECTOR round = P##_set1_epi32(ROUND);                                                                     \
+        size_t i = 0;                                                                                             \
+        for (; i + WIDTH <= count; i += WIDTH)                                                                    \
+        {                                                                                                         \
+            VECTOR s0 = round, s1 = round, s2 = round, s3 = round;                                                \
+            for (int t = 0; t < taps; t += 2)                                                                     \
+            {                                                                                                     \
+                VECTOR w = P##_set1_epi32(weightPair(weights[t], weights[t + 1]));                                \
+                VECTOR a = LOAD(reinterpret_cast<const VECTOR *>(rows[t] + i));                                   \
+                VECTOR b = LOAD(reinterpret_cast<const VECTOR *>(rows[t + 1] + i));                               \
+                VECTOR low = P##_unpacklo_epi8(a, b);                                                             \
+                VECTOR high = P##_unpackhi_epi8(a, b);                                                            \
+                s0 = P##_add_epi32(s0, P##_madd_epi16(P##_unpacklo_epi8(low, zero), w));                          \
+                s1 = P##_add_epi32(s1, P##_madd_epi16(P##_unpackhi_epi8(low, zero), w));                          \
+                s2 = P##_add_epi32(s2, P##_madd_epi16(P##_unpacklo_epi8(high, zero), w));                         \
+                s3 = P##_add_epi32(s3, P##_madd_epi16(P##_unpackhi_epi8(high, zero), w));                         \
+            }                                                                                                     \
+            VECTOR first = P##_packs_epi32(P##_srai_epi32(s0, SHIFT), P##_srai_epi32(s1, SHIFT));                 \
+            VECTOR second = P##_packs_epi32(P##_srai_epi32(s2, SHIFT), P##_srai_epi32(s3, SHIFT));                \
+            STORE(reinterpret_cast<VECTOR *>(out + i), P##_packus_epi16(first, second));                          \
+        }                                                                                                         \
+        verticalRange(rows, weights, taps, out, i, count);                                                        \
+    }
+
+    DEFINE_VERTICAL_KERNEL(verticalSsse3, "ssse3", __m128i, 16, _mm, _mm_loadu_si128, _mm_storeu_si128, _mm_setzero_si128)
+    DEFINE_VERTICAL_KERNEL(verticalAvx2, "avx2", __m256i, 32, _mm256, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_setzero_si256)
+
+#undef DEFINE_VERTICAL_KERNEL
+#endif
+
+    // Picks the passes for this CPU once (AVX-512 would not help the horizontal pass's small gathers)
+    PassKernels selectPassKernels()
+    {
+#if RESAMPLE_X86
+        if (kernels::isaEnabled("avx2"))
+        {
+            return {horizontalAvx2, verticalAvx2, boxRowSse2};
+        }
+        if (kernels::isaEnabled("ssse3"))
+        {
+            return {horizontalSsse3, verticalSsse3, boxRowSse2};
+        }
+        if (kernels::isaEnabled("sse2"))
+        {
+            return {horizontalScalar, verticalScalar, boxRowSse2};
+        }
+#endif
+        return {horizontalScalar, verticalScalar, boxRowScalar};
+    }
+
+    const PassKernels &passKernels()
+    {
+        static const PassKernels selected = selectPassKernels();
+        return selected;
+    }
+
+    // Exact average of factor x factor blocks (box filter, input exactly factor times the output both ways)
+    void boxDownscale(const uint8_t *input, size_t inputStride, uint8_t *output, int outputWidth, int outputHeight,
+                      size_t outputStride, int channels, int factor)
+    {
+        BoxRowKernel boxRow = passKernels().boxRow;
+        size_t inputRowBytes = static_cast<size_t>(outputWidth) * factor * channels;
+        ThreadPool::shared().parallelForRows(outputHeight, inputRowBytes * factor, [&](int first, int last)
+        {
+            thread_local std::vector<uint16_t> sums;
+            sums.resize(inputRowBytes + 4);
+            for (int y = first; y < last; y++)
+            {
+                boxRow(input + static_cast<size_t>(y) * factor * inputStride, inputStride, output + y * outputStride,
+                       outputWidth, channels, factor, sums.data());
+            } });
+    }
+}
+
+void resample::setFilter(Filter filter)
+{
+    currentFilter = filter;
+}
+
+resample::Filter resample::getFilter()
+{
+    return currentFilter;
+}
+
+resample::Filter resample::parseFilter(const std::string &name)
+{
+    if (name == "stbir")
+    {
+        return Filter::stbir;
+    }
+    if (name == "box")
+    {
+        return Filter::box;
+    }
+    if (name == "bilinear")
+    {
+        return Filter::bilinear;
+    }
+    if (name == "bicubic")
+    {
+        return Filter::bicubic;
+    }
+    if (name == "lanczos3")
+    {
+        return Filter::lanczos3;
+    }
+    throw std::invalid_argument("Error (Resample.cpp_parseFilter): unknown filter " + name);
+}
+
+resample::Axis resample::makeAxis(int inSize, int outSize, Filter filter)
+{
+    if (inSize <= 0 || outSize <= 0)
+    {
+        throw std::invalid_argument("Error (Resample.cpp_makeAxis): invalid dimensions");
+    }
+
+    // Pixel j covers [j, j + 1) in input coordinates; a downscale stretches the filter by the ratio
+    double scale = static_cast<double>(inSize) / outSize;
+    double stretch = std::max(scale, 1.0);
+    double support = filterRadius(filter) * stretch;
+
+    // Input pixels under each output pixel, [lower, upper)
+    std::vector<int> lower(outSize), upper(outSize);
+    int widest = 1;
+    for (int i = 0; i < outSize; i++)
+    {
+        double center = (i + 0.5) * scale;
+        lower[i] = std::max(0, static_cast<int>(std::floor(center - support)));
+        upper[i] = std::min(inSize, static_cast<int>(std::ceil(center + support)));
+        widest = std::max(widest, upper[i] - lower[i]);
+    }
+
+    Axis axis;
+    axis.inSize = inSize;
+    axis.outSize = outSize;
+    axis.filter = filter;
+    axis.taps = (widest + 3) / 4 * 4;
+    axis.first.resize(outSize);
+    axis.weights.assign(static_cast<size_t>(outSize) * axis.taps, 0);
+
+    std::vector<double> weights(axis.taps);
+    for (int i = 0; i < outSize; i++)
+    {
+        // Windows are moved left near the right edge so first + taps stays inside the input
+        double center = (i + 0.5) * scale;
+        int first = std::max(0, std::min(lower[i], inSize - axis.taps));
+        axis.first[i] = first;
+
+        std::fill(weights.begin(), weights.end(), 0.0);
+        double total = 0.0;
+        for (int j = lower[i]; j < upper[i]; j++)
+        {
+            double weight = filterWeight(filter, (j + 0.5 - center) / stretch);
+            weights[j - first] = weight;
+            total += weight;
+        }
+        if (total == 0.0)
+        {
+            // (cannot happen for these filters, but keeps a degenerate window from dividing by zero)
+            int nearest = std::min(std::max(static_cast<int>(center), 0), inSize - 1);
+            weights[nearest - first] = 1.0;
+            total = 1.0;
+        }
+
+        // Quantizes the normalized weights, giving any rounding error to the largest one so they sum to 1 << SHIFT
+        int16_t *quantized = axis.weights.data() + static_cast<size_t>(i) * axis.taps;
+        int sum = 0, largest = 0;
+        for (int t = 0; t < axis.taps; t++)
+        {
+            quantized[t] = static_cast<int16_t>(std::lround(weights[t] / total * (1 << SHIFT)));
+            sum += quantized[t];
+            largest = std::abs(quantized[t]) > std::abs(quantized[largest]) ? t : largest;
+        }
+        quantized[largest] = static_cast<int16_t>(quantized[largest] + (1 << SHIFT) - sum);
+    }
+
+    return axis;
+}
+
+void resample::resize(const uint8_t *input, int inputWidth, int inputHeight, size_t inputStride,
+                      uint8_t *output, int outputWidth, int outputHeight, size_t outputStride, int channels,
+                      const Axis &horizontal, const Axis &vertical)
+{
+    if (channels < 1 || channels > 4)
+    {
+        throw std::invalid_argument("Error (Resample.cpp_resize): channels must be 1 to 4");
+    }
+    if (horizontal.inSize != inputWidth || horizontal.outSize != outputWidth ||
+        vertical.inSize != inputHeight || vertical.outSize != outputHeight)
+    {
+        throw std::invalid_argument("Error (Resample.cpp_resize): weights computed for other dimensions");
+    }
+
+    size_t inputRowBytes = static_cast<size_t>(inputWidth) * channels;
+    size_t outputRowBytes = static_cast<size_t>(outputWidth) * channels;
+    ThreadPool &pool = ThreadPool::shared();
+
+    // Same size: every filter weighs the pixel under the output pixel 1 and its neighbors 0
+    if (inputWidth == outputWidth && inputHeight == outputHeight)
+    {
+        pool.parallelForRows(outputHeight, outputRowBytes, [&](int first, int last)
+        {
+            for (int y = first; y < last; y++)
+            {
+                std::memcpy(output + y * outputStride, input + y * inputStride, outputRowBytes);
+            } });
+        return;
+    }
+
+    // Box downscales by exactly 2 or 4 both ways
+    if (horizontal.filter == Filter::box && vertical.filter == Filter::box)
+    {
+        for (int factor : {2, 4})
+        {
+            if (inputWidth == outputWidth * factor && inputHeight == outputHeight * factor)
+            {
+                boxDownscale(input, inputStride, output, outputWidth, outputHeight, outputStride, channels, factor);
+                return;
+            }
+        }
+    }
+
+    const PassKernels &passes = passKernels();
+    int taps = vertical.taps;
+
+    // The horizontal pass reads whole 16-byte groups past each window, so a row whose reads would run
+    // past the end of the input is copied into a zero-padded row first (only the last few rows)
+    size_t reach = (static_cast<size_t>(horizontal.first.back()) + horizontal.taps) * channels + 16;
+    size_t inputBytes = static_cast<size_t>(inputHeight - 1) * inputStride + inputRowBytes;
+
+    // Horizontally filtered input rows are kept in a ring of taps rows, input row r in slot r % taps
+    size_t ringStride = (outputRowBytes + 63) / 64 * 64;
+
+    // Strips of output rows, each filtering the input rows it needs from its own ring
+    int threads = pool.getThreadCount();
+    int strips = std::max(1, std::min(threads > 1 ? threads * 2 : 1, outputHeight / MIN_STRIP_ROWS));
+    pool.parallelFor(strips, [&](int strip)
+    {
+        int firstRow = static_cast<int>(static_cast<long long>(outputHeight) * strip / strips);
+        int lastRow = static_cast<int>(static_cast<long long>(outputHeight) * (strip + 1) / strips);
+
+        thread_local std::vector<uint8_t> ring;
+        thread_local std::vector<uint8_t> padded;
+        thread_local std::vector<const uint8_t *> rows;
+        ring.resize(ringStride * taps);
+        rows.resize(taps);
+
+        int next = vertical.first[firstRow];
+        for (int y = firstRow; y < lastRow; y++)
+        {
+            int first = vertical.first[y];
+            int end = std::min(first + taps, inputHeight);
+            next = std::max(next, first);
+            for (; next < end; next++)
+            {
+                size_t offset = static_cast<size_t>(next) * inputStride;
+                const uint8_t *in = input + offset;
+                if (offset + reach > inputBytes)
+                {
+                    padded.assign(std::max(reach, inputRowBytes), 0);
+                    std::memcpy(padded.data(), in, inputRowBytes);
+                    in = padded.data();
+                }
+                passes.horizontal(in, ring.data() + static_cast<size_t>(next % taps) * ringStride, horizontal, channels);
+            }
+
+            // Rows past the bottom edge only appear with zero weights; they point at the last row
+            for (int t = 0; t < taps; t++)
+            {
+                int row = std::min(first + t, inputHeight - 1);
+                rows[t] = ring.data() + static_cast<size_t>(row % taps) * ringStride;
+            }
+
+            // Trailing zero weights (padding, or the edge) are skipped, keeping an even tap count
+            const int16_t *weights = vertical.weights.data() + static_cast<size_t>(y) * taps;
+            int used = taps;
+            while (used > 2 && weights[used - 1] == 0 && weights[used - 2] == 0)
+            {
+                used -= 2;
+            }
+            passes.vertical(rows.data(), weights, used, output + y * outputStride, outputRowBytes);
+        } });
+}
+
+void resample::resize(const uint8_t *input, int inputWidth, int inputHeight, size_t inputStride,
+                      uint8_t *output, int outputWidth, int outputHeight, size_t outputStride, int channels, Filter filter)
+{
+    resize(input, inputWidth, inputHeight, inputStride, output, outputWidth, outputHeight, outputStride, channels,
+           makeAxis(inputWidth, outputWidth, filter), makeAxis(inputHeight, outputHeight, filter));
+}
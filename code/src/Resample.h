@@ -0,0 +1,82 @@
+// Resample.h
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Separable resampler used by Image::resize in place of stb_image_resize. Every input row an output
+// strip needs is filtered horizontally once into a ring buffer, then each output row is a vertical
+// pass over the ring. Both passes use 16-bit fixed-point weights (14 fractional bits) and SSSE3 or
+// AVX2 multiply-adds, and the output rows are split into strips across the shared thread pool.
+// When downscaling, the filter is stretched by the ratio so every input pixel contributes; near the
+// edges, the weights of the pixels inside the image are renormalized. Box downscales by exactly 2 or
+// 4 in both directions average the 2 x 2 or 4 x 4 blocks directly.
+namespace resample
+{
+    enum class Filter
+    {
+        stbir,    // stb_image_resize (Mitchell downscaling, Catmull-Rom upscaling; one thread, float)
+        box,      // average of the input pixels under each output pixel (nearest pixel when upscaling)
+        bilinear, // triangle, radius 1
+        bicubic,  // Catmull-Rom cubic (a = -0.5), radius 2
+        lanczos3  // sinc windowed by sinc, radius 3
+    };
+
+    /* Sets the filter used by Image::resize for every following resize
+    ** @param filter: filter (bicubic by default)
+    */
+    void setFilter(Filter filter);
+
+    // Current filter
+    Filter getFilter();
+
+    /* Parses a filter name (stbir, box, bilinear, bicubic or lanczos3)
+    ** @param name: filter name
+    ** @return: filter (throws std::invalid_argument for an unknown name)
+    */
+    Filter parseFilter(const std::string &name);
+
+    // Fixed-point weights of one axis: output i = sum over t of weights[i * taps + t] * input[first[i] + t],
+    // with the weights of each output summing to 1 << 14. taps is a multiple of 4 (padded with zero weights).
+    struct Axis
+    {
+        int inSize = 0;
+        int outSize = 0;
+        Filter filter = Filter::stbir;
+        int taps = 0;
+        std::vector<int> first;
+        std::vector<int16_t> weights;
+    };
+
+    /* Computes the weights of one axis
+    ** @param inSize, outSize: number of input and output pixels (at least 1)
+    ** @param filter: any filter but stbir (throws std::invalid_argument)
+    ** @return: weights, with first[i] nondecreasing and first[i] + taps <= inSize whenever taps <= inSize
+    */
+    Axis makeAxis(int inSize, int outSize, Filter filter);
+
+    /* Resizes pixels with precomputed weights
+    ** @param input: first pixel of the source
+    ** @param inputWidth, inputHeight, inputStride: source dimensions and bytes between its rows
+    ** @param output: first pixel of the destination
+    ** @param outputWidth, outputHeight, outputStride: destination dimensions and bytes between its rows
+    ** @param channels: bytes per pixel (1 to 4)
+    ** @param horizontal, vertical: weights from makeAxis for (inputWidth, outputWidth) and (inputHeight, outputHeight)
+    */
+    void resize(const uint8_t *input, int inputWidth, int inputHeight, size_t inputStride,
+                uint8_t *output, int outputWidth, int outputHeight, size_t outputStride, int channels,
+                const Axis &horizontal, const Axis &vertical);
+
+    /* Resizes pixels, computing the weights for this call (see ResizeContext to keep them across calls)
+    ** @param input, inputWidth, inputHeight, inputStride, output, outputWidth, outputHeight, outputStride, channels: as above
+    ** @param filter: any filter but stbir
+    */
+    void resize(const uint8_t *input, int inputWidth, int inputHeight, size_t inputStride,
+                uint8_t *output, int outputWidth, int outputHeight, size_t outputStride, int channels, Filter filter);
+}
+
+#endif // RESAMPLE_H
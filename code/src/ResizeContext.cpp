@@ -0,0 +1,66 @@
+// ResizeContext.cpp
+
+#include "ResizeContext.h"
+#include "stb_image_resize.h"
+#include <stdexcept>
+
+// Constructor (the buffer is allocated by the first resize)
+ResizeContext::ResizeContext() : capacity(0) {}
+
+void ResizeContext::resize(const uint8_t *input, int inputWidth, int inputHeight, size_t inputStride,
+                           uint8_t *output, int outputWidth, int outputHeight, size_t outputStride, int channels,
+                           resample::Filter filter)
+{
+    if (filter != resample::Filter::stbir)
+    {
+        // The weights are rebuilt only when the geometry or filter changes
+        if (horizontal.inSize != inputWidth || horizontal.outSize != outputWidth || horizontal.filter != filter)
+        {
+            horizontal = resample::makeAxis(inputWidth, outputWidth, filter);
+        }
+        if (vertical.inSize != inputHeight || vertical.outSize != outputHeight || vertical.filter != filter)
+        {
+            vertical = resample::makeAxis(inputHeight, outputHeight, filter);
+        }
+        resample::resize(input, inputWidth, inputHeight, inputStride, output, outputWidth, outputHeight, outputStride,
+                         channels, horizontal, vertical);
+        return;
+    }
+
+    // The generic entry point with the defaults of stbir_resize_uint8, plus this context for its allocation
+    int ok = stbir_resize_uint8_generic(input, inputWidth, inputHeight, static_cast<int>(inputStride),
+                                        output, outputWidth, outputHeight, static_cast<int>(outputStride),
+                                        channels, STBIR_ALPHA_CHANNEL_NONE, 0, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT,
+                                        STBIR_COLORSPACE_LINEAR, this);
+    if (!ok)
+    {
+        throw std::runtime_error("Error (ResizeContext.cpp_resize): stb_image_resize failed");
+    }
+}
+
+size_t ResizeContext::getCapacity() const
+{
+    return capacity;
+}
+
+void *ResizeContext::allocate(size_t size)
+{
+    if (size > capacity)
+    {
+        // (operator new[] aligns the buffer for the floats and ints stbir keeps in it)
+        scratch.reset(new uint8_t[size]);
+        capacity = size;
+    }
+    return scratch.get();
+}
+
+void ResizeContext::release(void *)
+{
+    // The buffer is kept for the next resize
+}
+
+ResizeContext &ResizeContext::forThread()
+{
+    thread_local ResizeContext context;
+    return context;
+}
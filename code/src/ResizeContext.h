@@ -0,0 +1,63 @@
+// ResizeContext.h
+
+#ifndef RESIZE_CONTEXT_H
+#define RESIZE_CONTEXT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Resample.h"
+
+// State kept between resizes so that repeated resizes of same-sized frames only filter.
+// For the native resampler (see Resample.h) it holds the fixed-point weights of the last geometry
+// and filter, rebuilt only when either changes. For stb_image_resize it holds the working memory
+// stbir allocates on every call for its filter contributors, coefficients and ring buffer (see
+// STBIR_MALLOC in stb_image_impl.cpp); stbir still recomputes its coefficients on each call, as its
+// API cannot take precomputed ones.
+// A context must only be used by one thread at a time.
+class ResizeContext
+{
+private:
+    std::unique_ptr<uint8_t[]> scratch;
+    size_t capacity;
+    resample::Axis horizontal;
+    resample::Axis vertical;
+
+public:
+    ResizeContext();
+
+    ResizeContext(const ResizeContext &) = delete;
+    ResizeContext &operator=(const ResizeContext &) = delete;
+
+    /* Resizes pixels
+    ** @param input: first pixel of the source
+    ** @param inputWidth, inputHeight, inputStride: source dimensions and bytes between its rows
+    ** @param output: first pixel of the destination
+    ** @param outputWidth, outputHeight, outputStride: destination dimensions and bytes between its rows
+    ** @param channels: bytes per pixel (1 to 4 for the native filters)
+    ** @param filter: a native filter, or stbir for stbir_resize_uint8's filters and clamped edges
+    **                (throws std::runtime_error if stbir rejects the arguments)
+    */
+    void resize(const uint8_t *input, int inputWidth, int inputHeight, size_t inputStride,
+                uint8_t *output, int outputWidth, int outputHeight, size_t outputStride, int channels,
+                resample::Filter filter);
+
+    // Bytes of stbir working memory currently kept
+    size_t getCapacity() const;
+
+    /* Working memory for one resize (called by stbir through STBIR_MALLOC)
+    ** @param size: bytes needed
+    ** @return: the kept buffer, grown if it is too small
+    */
+    void *allocate(size_t size);
+
+    /* Returns working memory (called by stbir through STBIR_FREE; the kept buffer stays allocated)
+    ** @param memory: pointer from allocate
+    */
+    void release(void *memory);
+
+    // Context of the calling thread (used by Image::resize)
+    static ResizeContext &forThread();
+};
+
+#endif // RESIZE_CONTEXT_H
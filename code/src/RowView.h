@@ -0,0 +1,69 @@
+// RowView.h
+
+#ifndef ROW_VIEW_H
+#define ROW_VIEW_H
+
+#include <stdexcept>
+#include "BoundsCheck.h"
+
+template <typename T>
+class RowView
+{
+
+private:
+    T *data;
+    int size;
+
+public:
+    /* Constructor
+    ** @param data: pointer to the first element of the row (not owned)
+    ** @param size: number of elements in the row
+    */
+    RowView(T *data, int size) : data(data), size(size) {}
+
+    /* Subscript operator
+    ** @param index: index of the element to access
+    ** @return: element at the specified index
+    */
+    T &operator[](int index) const
+    {
+        // Checks to see if the index is within bounds (debug builds only)
+        if (BOUNDS_CHECK && (index < 0 || index >= size))
+        {
+            throw std::out_of_range("Error (RowView.h_[]): index out of bounds");
+        }
+
+        return data[index];
+    }
+
+    /* Raw pointer to the row
+    ** @return: pointer to the first element of the row
+    */
+    T *getData() const
+    {
+        return data;
+    }
+
+    /* Iterators (raw pointers over the row)
+    ** @return: pointer to the first element / one past the last element
+    */
+    T *begin() const
+    {
+        return data;
+    }
+
+    T *end() const
+    {
+        return data + size;
+    }
+
+    /* Size Getter
+    ** @return: number of elements in the row
+    */
+    int getSize() const
+    {
+        return size;
+    }
+};
+
+#endif // ROW_VIEW_H
@@ -0,0 +1,513 @@
+// Server.cpp
+
+#include "Server.h"
+#include "Image.h"
+#include "Pipeline.h"
+#include "StageTimer.h"
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace
+{
+    // Fields of a request
+    struct Request
+    {
+        std::string op;
+        std::vector<std::string> inputs;
+        std::string output;
+        std::string stages;
+        double alpha = 1.0;
+        bool hasAlpha = false;
+    };
+
+    // Minimal JSON reader for the request object: string, number and array-of-string values
+    class RequestParser
+    {
+    private:
+        const std::string &text;
+        size_t pos;
+
+        void fail(const std::string &message) const
+        {
+            throw std::invalid_argument("Error (Server.cpp_parse): " + message + " at offset " + std::to_string(pos));
+        }
+
+        void skipSpace()
+        {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+            {
+                pos++;
+            }
+        }
+
+        void expect(char c)
+        {
+            skipSpace();
+            if (pos >= text.size() || text[pos] != c)
+            {
+                fail(std::string("expected '") + c + "'");
+            }
+            pos++;
+        }
+
+        bool peek(char c)
+        {
+            skipSpace();
+            return pos < text.size() && text[pos] == c;
+        }
+
+        std::string parseString()
+        {
+            expect('"');
+            std::string value;
+            while (pos < text.size() && text[pos] != '"')
+            {
+                char c = text[pos++];
+                if (c == '\\')
+                {
+                    if (pos >= text.size())
+                    {
+                        break;
+                    }
+                    char escaped = text[pos++];
+                    switch (escaped)
+                    {
+                    case 'n':
+                        value += '\n';
+                        break;
+                    case 't':
+                        value += '\t';
+                        break;
+                    case 'r':
+                        value += '\r';
+                        break;
+                    case 'b':
+                        value += '\b';
+                        break;
+                    case 'f':
+                        value += '\f';
+                        break;
+                    case 'u':
+                    {
+                        // Only code points below 128 are expected in paths and stage lists
+                        if (pos + 4 > text.size())
+                        {
+                            fail("truncated escape");
+                        }
+                        unsigned long code = 0;
+                        for (size_t i = pos; i < pos + 4; i++)
+                        {
+                            char digit = text[i];
+                            if (!std::isxdigit(static_cast<unsigned char>(digit)))
+                            {
+                                fail("invalid escape");
+                            }
+                            code = code * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : std::tolower(static_cast<unsigned char>(digit)) - 'a' + 10);
+                        }
+                        if (code >= 128)
+                        {
+                            fail("unsupported escape");
+                        }
+                        value += static_cast<char>(code);
+                        pos += 4;
+                        break;
+                    }
+                    default:
+                        value += escaped;
+                    }
+                }
+                else
+                {
+                    value += c;
+                }
+            }
+            expect('"');
+            return value;
+        }
+
+        double parseNumber()
+        {
+            skipSpace();
+            size_t used = 0;
+            double value = 0.0;
+            try
+            {
+                value = std::stod(text.substr(pos), &used);
+            }
+            catch (const std::exception &)
+            {
+                fail("expected a number");
+            }
+            pos += used;
+            return value;
+        }
+
+    public:
+        explicit RequestParser(const std::string &text) : text(text), pos(0) {}
+
+        Request parse()
+        {
+            Request request;
+            expect('{');
+            bool first = true;
+            while (!peek('}'))
+            {
+                if (!first)
+                {
+                    expect(',');
+                }
+                first = false;
+
+                std::string key = parseString();
+                expect(':');
+                if (key == "op")
+                {
+                    request.op = parseString();
+                }
+                else if (key == "output")
+                {
+                    request.output = parseString();
+                }
+                else if (key == "stages")
+                {
+                    request.stages = parseString();
+                }
+                else if (key == "alpha")
+                {
+                    request.alpha = parseNumber();
+                    request.hasAlpha = true;
+                }
+                else if (key == "inputs")
+                {
+                    expect('[');
+                    while (!peek(']'))
+                    {
+                        if (!request.inputs.empty())
+                        {
+                            expect(',');
+                        }
+                        request.inputs.push_back(parseString());
+                    }
+                    expect(']');
+                }
+                else
+                {
+                    fail("unknown key " + key);
+                }
+            }
+            expect('}');
+            skipSpace();
+            if (pos != text.size())
+            {
+                fail("trailing characters");
+            }
+            return request;
+        }
+    };
+
+    // Quotes a string for a JSON reply
+    std::string quote(const std::string &value)
+    {
+        std::string quoted = "\"";
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                quoted += escaped;
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    // Saves an image, creating the output directory only when the first attempt fails
+    // (so requests into an existing directory cost no extra filesystem calls)
+    void saveCreatingDirectory(const Image &image, const std::string &output)
+    {
+        try
+        {
+            image.save(output);
+        }
+        catch (const std::runtime_error &)
+        {
+            std::filesystem::path directory = std::filesystem::path(output).parent_path();
+            if (directory.empty() || std::filesystem::exists(directory))
+            {
+                throw;
+            }
+            std::filesystem::create_directories(directory);
+            image.save(output);
+        }
+    }
+}
+
+std::string server::handle(const std::string &line, bool &shutdown)
+{
+    StageTimer timer("server.request");
+    try
+    {
+        Request request = RequestParser(line).parse();
+
+        if (request.op == "shutdown")
+        {
+            shutdown = true;
+            return "{\"ok\": true}";
+        }
+
+        bool binary = request.op == "add" || request.op == "subtract" || request.op == "dot";
+        if (!binary && request.op != "scale" && request.op != "pipe")
+        {
+            throw std::invalid_argument("Error (Server.cpp_handle): invalid op " + request.op);
+        }
+
+        size_t inputCount = binary ? 2 : 1;
+        if (request.output.empty() || request.inputs.size() != inputCount)
+        {
+            throw std::invalid_argument("Error (Server.cpp_handle): " + request.op + " needs " + std::to_string(inputCount) + " input(s) and an output");
+        }
+
+        Image image(request.inputs[0]);
+        if (binary)
+        {
+            Image other(request.inputs[1]);
+            if (request.op == "add")
+            {
+                image += other;
+            }
+            else if (request.op == "subtract")
+            {
+                image -= other;
+            }
+            else
+            {
+                image = image * other;
+            }
+        }
+        else if (request.op == "scale" && request.hasAlpha)
+        {
+            image.resize(static_cast<int>(image.getWidth() * request.alpha), static_cast<int>(image.getHeight() * request.alpha));
+        }
+        else if (request.op == "pipe" && !request.stages.empty())
+        {
+            Pipeline(request.stages).run(image);
+        }
+        else
+        {
+            throw std::invalid_argument("Error (Server.cpp_handle): " + request.op + " needs " + (request.op == "scale" ? "alpha" : "stages"));
+        }
+
+        saveCreatingDirectory(image, request.output);
+        return "{\"ok\": true, \"output\": " + quote(request.output) + "}";
+    }
+    catch (const std::exception &error)
+    {
+        return "{\"ok\": false, \"error\": " + quote(error.what()) + "}";
+    }
+}
+
+#ifndef _WIN32
+
+namespace
+{
+    // Longest request line a connection buffers while waiting for its '\n' (longer ones are rejected)
+    const size_t MAX_REQUEST_BYTES = 1 << 20;
+
+    // Reply to a request line over MAX_REQUEST_BYTES
+    std::string tooLongReply()
+    {
+        return "{\"ok\": false, \"error\": \"Error (Server.cpp_serve): request longer than " + std::to_string(MAX_REQUEST_BYTES) + " bytes\"}";
+    }
+
+    // Writes the whole buffer, retrying on partial writes
+    bool writeAll(int fd, const std::string &buffer)
+    {
+        size_t written = 0;
+        while (written < buffer.size())
+        {
+            ssize_t n = ::send(fd, buffer.data() + written, buffer.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+}
+
+void server::serve(const std::string &socketPath, std::ostream &log)
+{
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        throw std::invalid_argument("Error (Server.cpp_serve): socket path too long");
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        throw std::runtime_error(std::string("Error (Server.cpp_serve): socket failed: ") + std::strerror(errno));
+    }
+
+    // Replaces a socket left behind by an earlier server
+    ::unlink(socketPath.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0)
+    {
+        std::string reason = std::strerror(errno);
+        ::close(listener);
+        throw std::runtime_error("Error (Server.cpp_serve): could not listen on " + socketPath + ": " + reason);
+    }
+    log << "listening on " << socketPath << std::endl;
+
+    // Connection threads are detached; live counts the running ones so shutdown can wait for them
+    std::atomic<bool> stopping(false);
+    std::mutex clientsMutex;
+    std::condition_variable connectionEnded;
+    std::set<int> clients;
+    size_t live = 0;
+
+    while (!stopping)
+    {
+        int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR && !stopping)
+            {
+                continue;
+            }
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            clients.insert(client);
+            live++;
+        }
+
+        // Each connection reads request lines until the client disconnects
+        auto connection = [&, client]
+        {
+            std::string pending;
+            char buffer[4096];
+            bool open = true;
+            while (open)
+            {
+                ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    break;
+                }
+                pending.append(buffer, static_cast<size_t>(n));
+
+                for (size_t end; open && (end = pending.find('\n')) != std::string::npos;)
+                {
+                    std::string line = pending.substr(0, end);
+                    pending.erase(0, end + 1);
+                    if (line.find_first_not_of(" \t\r") == std::string::npos)
+                    {
+                        continue;
+                    }
+
+                    bool shutdown = false;
+                    open = writeAll(client, (line.size() > MAX_REQUEST_BYTES ? tooLongReply() : server::handle(line, shutdown)) + "\n");
+                    if (shutdown && !stopping.exchange(true))
+                    {
+                        // Wakes the accept loop so the server stops
+                        ::shutdown(listener, SHUT_RDWR);
+                    }
+                }
+
+                // A line that has not ended within the limit is rejected and the connection closed,
+                // as the rest of it cannot be told apart from the next request
+                if (open && pending.size() > MAX_REQUEST_BYTES)
+                {
+                    writeAll(client, tooLongReply() + "\n");
+                    open = false;
+                }
+            }
+
+            // Nothing of serve's state is touched after the count drops and the lock is released
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            clients.erase(client);
+            ::close(client);
+            live--;
+            connectionEnded.notify_all();
+        };
+
+        try
+        {
+            std::thread(connection).detach();
+        }
+        catch (const std::system_error &error)
+        {
+            // Out of threads: this client is dropped, the server keeps accepting
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            clients.erase(client);
+            ::close(client);
+            live--;
+            log << "could not start a connection thread: " << error.what() << std::endl;
+        }
+    }
+
+    // Disconnects the remaining clients and waits for their threads
+    {
+        std::unique_lock<std::mutex> lock(clientsMutex);
+        for (int client : clients)
+        {
+            ::shutdown(client, SHUT_RDWR);
+        }
+        connectionEnded.wait(lock, [&]
+                             { return live == 0; });
+    }
+
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+    log << "server stopped" << std::endl;
+}
+
+#else
+
+void server::serve(const std::string &socketPath, std::ostream &log)
+{
+    throw std::runtime_error("Error (Server.cpp_serve): server mode needs Unix domain sockets");
+}
+
+#endif
@@ -0,0 +1,37 @@
+// Server.h
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <ostream>
+#include <string>
+
+// Long-running server mode: requests arrive as JSON lines over a Unix domain socket and are
+// processed in this process, so the thread pool, the per-thread scratch buffers and the loaded
+// libraries stay warm between requests.
+//
+// Request (one JSON object per line):
+//   {"op": "add", "inputs": ["a.png", "b.png"], "output": "out/sum.png"}
+//   op is add, subtract or dot (two inputs), scale (one input and "alpha", resizes like the
+//   scale function), pipe (one input and "stages", see Pipeline.h) or shutdown.
+// Reply (one JSON line, sent once the output has been written):
+//   {"ok": true, "output": "out/sum.png"}  or  {"ok": false, "error": "..."}
+namespace server
+{
+    /* Processes one request
+    ** @param request: request line (JSON object)
+    ** @param shutdown: set to true when the request asks the server to stop
+    ** @return: reply line (JSON object, without the trailing newline)
+    */
+    std::string handle(const std::string &request, bool &shutdown);
+
+    /* Listens on a Unix domain socket until a shutdown request arrives (not available on Windows)
+    ** Every connection is served on its own (detached) thread and may send any number of requests,
+    ** each line at most 1 MiB (a longer one gets an error reply).
+    ** @param socketPath: path of the socket (an existing socket file there is replaced)
+    ** @param log: stream for status messages
+    */
+    void serve(const std::string &socketPath, std::ostream &log);
+}
+
+#endif // SERVER_H
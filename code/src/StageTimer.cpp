@@ -0,0 +1,70 @@
+// StageTimer.cpp
+
+#include "StageTimer.h"
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+namespace
+{
+    // Accumulated time and number of calls of one stage
+    struct StageTotal
+    {
+        double seconds = 0.0;
+        long calls = 0;
+    };
+
+    std::atomic<bool> enabled(false);
+    std::mutex totalsMutex;
+    std::map<std::string, StageTotal> totals;
+}
+
+// Constructor
+StageTimer::StageTimer(const std::string &stage)
+{
+    if (enabled)
+    {
+        this->stage = stage;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+// Destructor
+StageTimer::~StageTimer()
+{
+    // Timers created while timing was disabled have no stage name
+    if (stage.empty())
+    {
+        return;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    StageTotal &total = totals[stage];
+    total.seconds += elapsed.count();
+    total.calls++;
+}
+
+void StageTimer::setEnabled(bool enabled)
+{
+    ::enabled = enabled;
+}
+
+bool StageTimer::isEnabled()
+{
+    return enabled;
+}
+
+void StageTimer::report(std::ostream &out)
+{
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    out << std::left << std::setw(20) << "stage" << std::right << std::setw(12) << "total (ms)" << std::setw(8) << "calls" << std::setw(12) << "avg (ms)" << "\n";
+    for (const auto &entry : totals)
+    {
+        const StageTotal &total = entry.second;
+        out << std::left << std::setw(20) << entry.first << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << total.seconds * 1000.0 << std::setw(8) << total.calls
+            << std::setw(12) << total.seconds * 1000.0 / total.calls << "\n";
+    }
+}
@@ -0,0 +1,42 @@
+// StageTimer.h
+
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+class StageTimer
+{
+private:
+    std::string stage;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    /* Constructor (starts timing a stage, does nothing when timing is disabled)
+    ** @param stage: name of the stage, e.g. "save.encode"
+    */
+    explicit StageTimer(const std::string &stage);
+
+    // Destructor (adds the elapsed time to the stage's total)
+    ~StageTimer();
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+    /* Turns stage timing on or off for the whole process
+    ** @param enabled: true to record stage times
+    */
+    static void setEnabled(bool enabled);
+
+    // Whether stage times are being recorded
+    static bool isEnabled();
+
+    /* Writes the total time, call count and average time of every recorded stage
+    ** @param out: output stream
+    */
+    static void report(std::ostream &out);
+};
+
+#endif // STAGE_TIMER_H
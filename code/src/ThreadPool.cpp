@@ -0,0 +1,188 @@
+// ThreadPool.cpp
+
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    // Set on pool workers so nested parallelFor calls run serially instead of deadlocking
+    thread_local bool insideTask = false;
+
+    std::mutex sharedMutex;
+    std::unique_ptr<ThreadPool> sharedPool;
+    int sharedThreads = 0;
+
+    // Default row band size: small enough that a band of every operand stays in a core's L2 cache
+    const size_t DEFAULT_GRAIN = 256 * 1024;
+    std::atomic<size_t> grainSize(DEFAULT_GRAIN);
+
+    int defaultThreadCount()
+    {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 0 ? static_cast<int>(cores) : 1;
+    }
+}
+
+// Constructor
+ThreadPool::ThreadPool(int threads)
+    : task(nullptr), count(0), next(0), active(0), generation(0), stopping(false)
+{
+    // The calling thread is one of the threads, so start one worker fewer
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+// Destructor
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobPosted.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+int ThreadPool::getThreadCount() const
+{
+    return static_cast<int>(workers.size()) + 1;
+}
+
+void ThreadPool::work()
+{
+    insideTask = true;
+    long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        jobPosted.wait(lock, [&]
+                       { return stopping || generation != seen; });
+        if (stopping)
+        {
+            return;
+        }
+        seen = generation;
+        runTasks(lock);
+    }
+}
+
+void ThreadPool::runTasks(std::unique_lock<std::mutex> &lock)
+{
+    active++;
+    while (next < count)
+    {
+        int index = next++;
+        lock.unlock();
+        try
+        {
+            (*task)(index);
+        }
+        catch (...)
+        {
+            lock.lock();
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            // Skips the tasks nobody started yet
+            next = count;
+            continue;
+        }
+        lock.lock();
+    }
+    if (--active == 0)
+    {
+        jobFinished.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &task)
+{
+    // Runs serially when there is nothing to share, when called from inside a task or while the pool is busy
+    std::unique_lock<std::mutex> submitLock(submitMutex, std::defer_lock);
+    if (workers.empty() || count <= 1 || insideTask || !submitLock.try_lock())
+    {
+        for (int i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    this->task = &task;
+    this->count = count;
+    next = 0;
+    error = nullptr;
+    generation++;
+    jobPosted.notify_all();
+
+    // The calling thread works on the job too, then waits for the workers still running a task
+    insideTask = true;
+    runTasks(lock);
+    insideTask = false;
+    jobFinished.wait(lock, [&]
+                     { return active == 0; });
+    this->task = nullptr;
+
+    if (error)
+    {
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
+
+void ThreadPool::parallelForRows(int rows, size_t rowBytes, const std::function<void(int first, int last)> &body)
+{
+    if (rows <= 0)
+    {
+        return;
+    }
+
+    // Rows per band, so each band covers about one grain of bytes
+    size_t grain = grainSize;
+    int bandRows = rowBytes > 0 && rowBytes < grain ? static_cast<int>(grain / rowBytes) : 1;
+    int bands = (rows + bandRows - 1) / bandRows;
+    parallelFor(bands, [&](int band)
+                {
+        int first = band * bandRows;
+        int last = first + bandRows < rows ? first + bandRows : rows;
+        body(first, last); });
+}
+
+void ThreadPool::setGrainSize(size_t bytes)
+{
+    grainSize = bytes > 0 ? bytes : DEFAULT_GRAIN;
+}
+
+size_t ThreadPool::getGrainSize()
+{
+    return grainSize;
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (!sharedPool)
+    {
+        sharedPool.reset(new ThreadPool(sharedThreads > 0 ? sharedThreads : defaultThreadCount()));
+    }
+    return *sharedPool;
+}
+
+void ThreadPool::setSharedThreadCount(int threads)
+{
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    sharedThreads = threads;
+    if (sharedPool && sharedPool->getThreadCount() != (threads > 0 ? threads : defaultThreadCount()))
+    {
+        sharedPool.reset();
+    }
+}
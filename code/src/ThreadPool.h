@@ -0,0 +1,91 @@
+// ThreadPool.h
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+
+    // Guards the current job and wakes the workers when one is posted
+    std::mutex mutex;
+    std::condition_variable jobPosted;
+    std::condition_variable jobFinished;
+
+    // Only one parallelFor runs on the pool at a time
+    std::mutex submitMutex;
+
+    // Current job: task(i) for every i in [0, count), handed out in order
+    const std::function<void(int)> *task;
+    int count;
+    int next;
+    int active;
+    long generation;
+    bool stopping;
+    std::exception_ptr error;
+
+    // Worker loop
+    void work();
+
+    // Runs indices of the current job until none are left (called with the mutex held)
+    void runTasks(std::unique_lock<std::mutex> &lock);
+
+public:
+    /* Constructor
+    ** @param threads: total number of threads that run tasks, including the calling thread
+    */
+    explicit ThreadPool(int threads);
+
+    // Destructor (stops and joins the workers)
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of threads that run tasks (the workers plus the calling thread)
+    int getThreadCount() const;
+
+    /* Runs task(i) for every i in [0, count) and returns when all of them finished
+    ** The calling thread runs tasks too. Calls made from inside a task, or while another
+    ** thread's call is in progress, run serially on the calling thread instead.
+    ** The first exception thrown by a task is rethrown here.
+    ** @param count: number of tasks
+    ** @param task: function called with each task index
+    */
+    void parallelFor(int count, const std::function<void(int)> &task);
+
+    /* Runs body over row bands of an image: rows [0, rows) are cut into bands of about
+    ** getGrainSize() bytes (at least one row each), and the bands are spread across the pool
+    ** @param rows: number of rows
+    ** @param rowBytes: bytes processed per row (used to size the bands)
+    ** @param body: function called with each band's [first, last) row range
+    */
+    void parallelForRows(int rows, size_t rowBytes, const std::function<void(int first, int last)> &body);
+
+    /* Sets the target number of bytes per row band for parallelForRows
+    ** @param bytes: band size in bytes (0 restores the default, sized to stay in a core's L2 cache)
+    */
+    static void setGrainSize(size_t bytes);
+
+    // Target number of bytes per row band
+    static size_t getGrainSize();
+
+    // Process-wide pool, created on first use with setSharedThreadCount threads (default: one per core)
+    static ThreadPool &shared();
+
+    /* Sets the size of the shared pool (recreates it if it already exists)
+    ** @param threads: number of threads (0 means one per core)
+    */
+    static void setSharedThreadCount(int threads);
+};
+
+#endif // THREAD_POOL_H
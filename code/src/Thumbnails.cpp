@@ -0,0 +1,181 @@
+// Thumbnails.cpp
+
+#include "Thumbnails.h"
+#include "ResizeContext.h"
+#include "StageTimer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    // Parses one dimension of a size (empty means 0, to be resolved from the aspect ratio)
+    int parseDimension(const std::string &text, const std::string &entry)
+    {
+        if (text.size() > 6)
+        {
+            throw std::invalid_argument("Error (Thumbnails.cpp_parseSizes): invalid size " + entry);
+        }
+        int value = 0;
+        for (char c : text)
+        {
+            if (!std::isdigit(static_cast<unsigned char>(c)))
+            {
+                throw std::invalid_argument("Error (Thumbnails.cpp_parseSizes): invalid size " + entry);
+            }
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    }
+}
+
+std::vector<thumbnails::Size> thumbnails::parseSizes(const std::string &list)
+{
+    std::vector<Size> sizes;
+    std::stringstream stream(list);
+    for (std::string entry; std::getline(stream, entry, ',');)
+    {
+        size_t separator = entry.find_first_of("xX");
+        Size size;
+        size.width = parseDimension(entry.substr(0, separator), entry);
+        size.height = separator == std::string::npos ? 0 : parseDimension(entry.substr(separator + 1), entry);
+        if (size.width == 0 && size.height == 0)
+        {
+            throw std::invalid_argument("Error (Thumbnails.cpp_parseSizes): invalid size " + entry);
+        }
+        sizes.push_back(size);
+    }
+    if (sizes.empty())
+    {
+        throw std::invalid_argument("Error (Thumbnails.cpp_parseSizes): no sizes given");
+    }
+    return sizes;
+}
+
+thumbnails::Size thumbnails::resolve(Size size, int sourceWidth, int sourceHeight)
+{
+    if (size.width <= 0 && size.height <= 0)
+    {
+        throw std::invalid_argument("Error (Thumbnails.cpp_resolve): invalid size");
+    }
+    if (size.width <= 0)
+    {
+        size.width = static_cast<int>(std::lround(static_cast<double>(size.height) * sourceWidth / sourceHeight));
+    }
+    else if (size.height <= 0)
+    {
+        size.height = static_cast<int>(std::lround(static_cast<double>(size.width) * sourceHeight / sourceWidth));
+    }
+    size.width = std::max(size.width, 1);
+    size.height = std::max(size.height, 1);
+    return size;
+}
+
+std::vector<Image> thumbnails::build(const Image &source, const std::vector<Size> &sizes)
+{
+    std::vector<Size> targets;
+    for (const Size &size : sizes)
+    {
+        targets.push_back(resolve(size, source.getWidth(), source.getHeight()));
+    }
+
+    // Whether some thumbnail fits within width x height (so a level of that size would be used)
+    auto needed = [&](int width, int height)
+    {
+        for (const Size &target : targets)
+        {
+            if (target.width <= width && target.height <= height)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    ResizeContext &context = ResizeContext::forThread();
+
+    // Mip chain: levels[0] is the source, each next level half the one before (rounded down).
+    // The halves live in a deque so the level pointers stay valid as it grows.
+    std::vector<const Image *> levels = {&source};
+    std::deque<Image> halves;
+    {
+        StageTimer timer("thumbs.chain");
+        for (;;)
+        {
+            const Image &last = *levels.back();
+            int width = std::max(last.getWidth() / 2, 1);
+            int height = std::max(last.getHeight() / 2, 1);
+            if ((width == last.getWidth() && height == last.getHeight()) || !needed(width, height))
+            {
+                break;
+            }
+            halves.emplace_back("", last.getChannels(), width, height);
+            Image &half = halves.back();
+            context.resize(last.getData(), last.getWidth(), last.getHeight(), last.getStride(),
+                           half.getData(), width, height, half.getStride(), last.getChannels(), resample::Filter::box);
+            levels.push_back(&half);
+        }
+    }
+
+    // Each thumbnail comes from the smallest level that still covers it
+    StageTimer timer("thumbs.resize");
+    std::vector<Image> thumbs(targets.size());
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        size_t level = levels.size() - 1;
+        while (level > 0 && (levels[level]->getWidth() < targets[i].width || levels[level]->getHeight() < targets[i].height))
+        {
+            level--;
+        }
+        levels[level]->resizeInto(thumbs[i], targets[i].width, targets[i].height, context);
+    }
+    return thumbs;
+}
+
+std::vector<std::string> thumbnails::write(const Image &source, const std::vector<Size> &sizes, const std::string &outputDirectory,
+                                           const std::string &name, const std::string &extension)
+{
+    // Entries that resolve to the same dimensions share one thumbnail and one file
+    std::vector<Size> distinct;
+    std::vector<size_t> thumbOf;
+    for (const Size &size : sizes)
+    {
+        Size resolved = resolve(size, source.getWidth(), source.getHeight());
+        size_t i = 0;
+        while (i < distinct.size() && (distinct[i].width != resolved.width || distinct[i].height != resolved.height))
+        {
+            i++;
+        }
+        if (i == distinct.size())
+        {
+            distinct.push_back(resolved);
+        }
+        thumbOf.push_back(i);
+    }
+
+    std::vector<Image> thumbs = build(source, distinct);
+
+    std::filesystem::create_directories(outputDirectory);
+    std::vector<std::string> files;
+    for (const Image &thumb : thumbs)
+    {
+        std::string file = name + "_" + std::to_string(thumb.getWidth()) + "x" + std::to_string(thumb.getHeight()) + extension;
+        files.push_back((std::filesystem::path(outputDirectory) / file).string());
+    }
+
+    // One thumbnail per task; the encoders' own parallel loops then run serially inside each task
+    ThreadPool::shared().parallelFor(static_cast<int>(thumbs.size()), [&](int i)
+                                     { thumbs[i].save(files[i]); });
+
+    std::vector<std::string> paths;
+    for (size_t i : thumbOf)
+    {
+        paths.push_back(files[i]);
+    }
+    return paths;
+}
@@ -0,0 +1,57 @@
+// Thumbnails.h
+
+#ifndef THUMBNAILS_H
+#define THUMBNAILS_H
+
+#include <string>
+#include <vector>
+#include "Image.h"
+
+// Several resized copies of one image built in a single job. The source is decoded once and halved
+// repeatedly with the box filter (a mip chain, each level filtering the one before it, so the
+// large levels are read once for all sizes). Each thumbnail is then resized with the current
+// filter (see Resample.h) from the smallest level at least as large as it, so every final resize
+// shrinks by less than 2 and reads a fraction of the source.
+namespace thumbnails
+{
+    // Target size of one thumbnail (a dimension of 0 follows the source's aspect ratio)
+    struct Size
+    {
+        int width = 0;
+        int height = 0;
+    };
+
+    /* Parses a comma-separated list of sizes, each WxH, W (height from the aspect ratio) or xH
+    ** @param list: e.g. "1024,512x512,x128"
+    ** @return: sizes in the order given (throws std::invalid_argument for a malformed entry)
+    */
+    std::vector<Size> parseSizes(const std::string &list);
+
+    /* Fills in a dimension left at 0 from the source's aspect ratio
+    ** @param size: target size (at least one dimension positive)
+    ** @param sourceWidth, sourceHeight: dimensions of the source
+    ** @return: size with both dimensions at least 1
+    */
+    Size resolve(Size size, int sourceWidth, int sourceHeight);
+
+    /* Builds every thumbnail of one source
+    ** @param source: decoded image
+    ** @param sizes: target sizes (larger than the source is allowed, and resized from the source)
+    ** @return: one image per size, in the same order
+    */
+    std::vector<Image> build(const Image &source, const std::vector<Size> &sizes);
+
+    /* Builds every thumbnail and saves them, encoding in parallel on the shared thread pool
+    ** Sizes that resolve to the same dimensions are built and saved once.
+    ** @param source: decoded image
+    ** @param sizes: target sizes
+    ** @param outputDirectory: directory for the thumbnails (created if needed)
+    ** @param name: file name prefix; each file is <output directory>/<name>_<width>x<height><extension>
+    ** @param extension: extension of the files, which selects their format (see Formats.h)
+    ** @return: path of the saved file for each size, in the order of sizes (repeated for duplicates)
+    */
+    std::vector<std::string> write(const Image &source, const std::vector<Size> &sizes, const std::string &outputDirectory,
+                                   const std::string &name, const std::string &extension);
+}
+
+#endif // THUMBNAILS_H
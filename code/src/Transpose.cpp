@@ -0,0 +1,197 @@
+// Transpose.cpp
+
+#include "Transpose.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPOSE_X86 1
+#include <emmintrin.h>
+#else
+#define TRANSPOSE_X86 0
+#endif
+
+namespace
+{
+    // Outer block edge (in elements): a block of source rows and destination rows stays in L1/L2
+    const int BLOCK = 64;
+
+    // Generic element transpose of a (rows x cols) tile
+    void tileScalar(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride, int rows, int cols, int elementSize)
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            const uint8_t *in = src + i * srcStride;
+            for (int j = 0; j < cols; j++)
+            {
+                std::memcpy(dst + j * dstStride + static_cast<size_t>(i) * elementSize, in + static_cast<size_t>(j) * elementSize, elementSize);
+            }
+        }
+    }
+
+#if TRANSPOSE_X86
+    // 16 x 16 bytes: four rounds of unpacks (8, 16, 32 then 64 bit) turn 16 rows into 16 columns
+    __attribute__((target("sse2"))) void tile16x16(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride)
+    {
+        __m128i r[16], a[16], b[16];
+        for (int i = 0; i < 16; i++)
+        {
+            r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * srcStride));
+        }
+
+        // b[i]: rows 2i, 2i+1 of columns 0-7, b[8 + i]: the same rows of columns 8-15
+        for (int i = 0; i < 8; i++)
+        {
+            b[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+            b[8 + i] = _mm_unpackhi_epi8(r[2 * i], r[2 * i + 1]);
+        }
+
+        // a[4g + i]: rows 4i to 4i+3 of columns 4g to 4g+3
+        for (int half = 0; half < 2; half++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                a[half * 8 + i] = _mm_unpacklo_epi16(b[half * 8 + 2 * i], b[half * 8 + 2 * i + 1]);
+                a[half * 8 + 4 + i] = _mm_unpackhi_epi16(b[half * 8 + 2 * i], b[half * 8 + 2 * i + 1]);
+            }
+        }
+
+        // b[4g + 2h + j]: rows 8j to 8j+7 of columns 4g+2h and 4g+2h+1
+        for (int g = 0; g < 4; g++)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                b[g * 4 + j] = _mm_unpacklo_epi32(a[g * 4 + 2 * j], a[g * 4 + 2 * j + 1]);
+                b[g * 4 + 2 + j] = _mm_unpackhi_epi32(a[g * 4 + 2 * j], a[g * 4 + 2 * j + 1]);
+            }
+        }
+
+        // Joins the two row halves of every column and stores it as a destination row
+        for (int g = 0; g < 4; g++)
+        {
+            for (int h = 0; h < 2; h++)
+            {
+                int column = g * 4 + h * 2;
+                __m128i top = b[g * 4 + h * 2];
+                __m128i bottom = b[g * 4 + h * 2 + 1];
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + column * dstStride), _mm_unpacklo_epi64(top, bottom));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + (column + 1) * dstStride), _mm_unpackhi_epi64(top, bottom));
+            }
+        }
+    }
+
+    // 4 x 4 elements of 4 bytes (one RGBA pixel each)
+    __attribute__((target("sse2"))) void tile4x4Pixels(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride)
+    {
+        __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + srcStride));
+        __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * srcStride));
+        __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * srcStride));
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + dstStride), _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * dstStride), _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * dstStride), _mm_unpackhi_epi64(t2, t3));
+    }
+#endif
+
+    // Whether the SSE2 micro-kernels may run (decided once, honouring IMAGE_SIMD)
+    bool useSse2()
+    {
+        static const bool enabled = kernels::isaEnabled("sse2");
+        return enabled;
+    }
+
+    // Transposes one outer block, using the register micro-kernels where a full tile fits
+    void block(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride, int rows, int cols, int elementSize)
+    {
+#if TRANSPOSE_X86
+        int tile = !useSse2() ? 0 : elementSize == 1 ? 16 : elementSize == 4 ? 4 : 0;
+        if (tile > 0)
+        {
+            int fullRows = rows / tile * tile;
+            int fullCols = cols / tile * tile;
+            for (int i = 0; i < fullRows; i += tile)
+            {
+                for (int j = 0; j < fullCols; j += tile)
+                {
+                    const uint8_t *in = src + i * srcStride + static_cast<size_t>(j) * elementSize;
+                    uint8_t *out = dst + j * dstStride + static_cast<size_t>(i) * elementSize;
+                    if (elementSize == 1)
+                    {
+                        tile16x16(in, srcStride, out, dstStride);
+                    }
+                    else
+                    {
+                        tile4x4Pixels(in, srcStride, out, dstStride);
+                    }
+                }
+            }
+
+            // Right edge (all rows) and bottom edge (full-tile columns only)
+            tileScalar(src + static_cast<size_t>(fullCols) * elementSize, srcStride, dst + fullCols * dstStride, dstStride, rows, cols - fullCols, elementSize);
+            tileScalar(src + fullRows * srcStride, srcStride, dst + static_cast<size_t>(fullRows) * elementSize, dstStride, rows - fullRows, fullCols, elementSize);
+            return;
+        }
+#endif
+        tileScalar(src, srcStride, dst, dstStride, rows, cols, elementSize);
+    }
+}
+
+namespace transpose
+{
+    void outOfPlace(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride, int rows, int cols, int elementSize)
+    {
+        // Each task handles one stripe of BLOCK source rows (= BLOCK destination columns)
+        int stripes = (rows + BLOCK - 1) / BLOCK;
+        ThreadPool::shared().parallelFor(stripes, [&](int stripe)
+                                         {
+            int i = stripe * BLOCK;
+            int blockRows = rows - i < BLOCK ? rows - i : BLOCK;
+            for (int j = 0; j < cols; j += BLOCK)
+            {
+                int blockCols = cols - j < BLOCK ? cols - j : BLOCK;
+                block(src + i * srcStride + static_cast<size_t>(j) * elementSize, srcStride,
+                      dst + j * dstStride + static_cast<size_t>(i) * elementSize, dstStride,
+                      blockRows, blockCols, elementSize);
+            } });
+    }
+
+    void squareInPlace(uint8_t *data, size_t stride, int n, int elementSize)
+    {
+        // Each task handles the blocks on and right of the diagonal in one block row,
+        // swapping every block (I, J) with its mirror (J, I)
+        int blocks = (n + BLOCK - 1) / BLOCK;
+        ThreadPool::shared().parallelFor(blocks, [&](int blockRow)
+                                         {
+            thread_local std::vector<uint8_t> scratchTile;
+            size_t scratchStride = static_cast<size_t>(BLOCK) * elementSize;
+            scratchTile.resize(scratchStride * BLOCK);
+            uint8_t *scratch = scratchTile.data();
+
+            int i = blockRow * BLOCK;
+            int blockRows = n - i < BLOCK ? n - i : BLOCK;
+            for (int j = i; j < n; j += BLOCK)
+            {
+                int blockCols = n - j < BLOCK ? n - j : BLOCK;
+                uint8_t *upper = data + i * stride + static_cast<size_t>(j) * elementSize;
+                uint8_t *lower = data + j * stride + static_cast<size_t>(i) * elementSize;
+
+                // scratch = upper^T, then upper = lower^T (diagonal blocks skip this), then lower = scratch
+                block(upper, stride, scratch, scratchStride, blockRows, blockCols, elementSize);
+                if (j != i)
+                {
+                    block(lower, stride, upper, stride, blockCols, blockRows, elementSize);
+                }
+                for (int r = 0; r < blockCols; r++)
+                {
+                    std::memcpy(lower + r * stride, scratch + r * scratchStride, static_cast<size_t>(blockRows) * elementSize);
+                }
+            } });
+    }
+}
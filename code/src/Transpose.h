@@ -0,0 +1,33 @@
+// Transpose.h
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Cache-blocked matrix transposes. Elements are elementSize bytes wide (1 for a Matrix of
+// bytes, the channel count for interleaved pixels); 1- and 4-byte elements use SSE2 16x16 and
+// 4x4 register transposes (unless IMAGE_SIMD=scalar, see Kernels.h), other sizes a blocked scalar copy.
+namespace transpose
+{
+    /* Out-of-place transpose: dst[j][i] = src[i][j]
+    ** @param src: first byte of the (rows x cols) source
+    ** @param srcStride: bytes between rows of src
+    ** @param dst: first byte of the (cols x rows) destination (must not overlap src)
+    ** @param dstStride: bytes between rows of dst
+    ** @param rows, cols: source dimensions in elements
+    ** @param elementSize: bytes per element
+    */
+    void outOfPlace(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride, int rows, int cols, int elementSize);
+
+    /* In-place transpose of a square matrix (swaps mirrored blocks through a small scratch tile)
+    ** @param data: first byte of the (n x n) matrix
+    ** @param stride: bytes between rows
+    ** @param n: number of rows and columns in elements
+    ** @param elementSize: bytes per element
+    */
+    void squareInPlace(uint8_t *data, size_t stride, int n, int elementSize);
+}
+
+#endif // TRANSPOSE_H
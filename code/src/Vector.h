@@ -5,13 +5,14 @@
 
 #include <iostream>
 #include <stdexcept>
+#include "BoundsCheck.h"
 
 template <typename T>
 class Vector
 {
 
 private:
-    T *data;
+    T *elements;
     int size;
 
 public:
@@ -27,7 +28,7 @@ public:
         }
 
         // Allocates memory for the vector of the specified size
-        data = new T[size]{};
+        elements = new T[size]{};
     }
 
     /* Copy Constructor
@@ -36,15 +37,24 @@ public:
     Vector(const Vector &other) : size(other.size)
     {
         // Allocates memory for the vector of the same size
-        data = new T[size];
+        elements = new T[size];
 
         // Copies the data from the other vector
         for (int i = 0; i < size; i++)
         {
-            data[i] = other.data[i];
+            elements[i] = other.elements[i];
         }
     }
 
+    /* Move Constructor
+    ** @param other: vector object to move from (takes ownership of its data, leaving it empty)
+    */
+    Vector(Vector &&other) noexcept : elements(other.elements), size(other.size)
+    {
+        other.elements = nullptr;
+        other.size = 0;
+    }
+
     /* Assignment Operator
     ** @param other: vector object to assign (copies data)
     */
@@ -56,26 +66,44 @@ public:
             // Checks to see if data needs to be reallocated depending on the compatibility of the sizes of both vectors
             if (other.size != size)
             {
-                delete[] data;
+                delete[] elements;
                 size = other.size;
-                data = new T[size];
+                elements = new T[size];
             }
 
             // Copies the data from the other vector
             for (int i = 0; i < size; i++)
             {
-                data[i] = other.data[i];
+                elements[i] = other.elements[i];
             }
         }
 
         return *this;
     }
 
+    /* Move Assignment Operator
+    ** @param other: vector object to move from (takes ownership of its data, leaving it empty)
+    */
+    Vector &operator=(Vector &&other) noexcept
+    {
+        // Checks for self-assignment
+        if (this != &other)
+        {
+            delete[] elements;
+            elements = other.elements;
+            size = other.size;
+            other.elements = nullptr;
+            other.size = 0;
+        }
+
+        return *this;
+    }
+
     // Destructor
     ~Vector()
     {
         // Deallocates memory for the vector
-        delete[] data;
+        delete[] elements;
     }
 
     /* Input stream operator
@@ -87,7 +115,7 @@ public:
         // Inputs the data into the input stream
         for (int i = 0; i < vec.size; i++)
         {
-            in >> vec.data[i];
+            in >> vec.elements[i];
         }
 
         return in;
@@ -102,7 +130,7 @@ public:
         // Outputs the data into the output stream
         for (int i = 0; i < vec.size; i++)
         {
-            out << vec.data[i] << " ";
+            out << vec.elements[i] << " ";
         }
         out << "\n";
 
@@ -127,7 +155,7 @@ public:
         // Adds the data from both vectors and stores it in the new vector
         for (int i = 0; i < size; i++)
         {
-            result.data[i] = data[i] + other.data[i];
+            result.elements[i] = elements[i] + other.elements[i];
         }
 
         return result;
@@ -151,7 +179,7 @@ public:
         // Subtracts the data from both vectors and stores it in the new vector
         for (int i = 0; i < size; i++)
         {
-            result.data[i] = data[i] - other.data[i];
+            result.elements[i] = elements[i] - other.elements[i];
         }
 
         return result;
@@ -175,37 +203,125 @@ public:
         // Multiplies the data from both vectors and stores it in the new vector
         for (int i = 0; i < size; i++)
         {
-            result.data[i] = data[i] * other.data[i];
+            result.elements[i] = elements[i] * other.elements[i];
         }
         return result;
     }
 
+    /* Compound addition operator (in place)
+    ** @param other: vector object to add
+    ** @return: this vector
+    */
+    Vector<T> &operator+=(const Vector<T> &other)
+    {
+        // Checks to see if the sizes of both vectors are compatible
+        if (size != other.size)
+        {
+            throw std::invalid_argument("Error (Vector.h/operator+=): different vector sizes");
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+            elements[i] += other.elements[i];
+        }
+
+        return *this;
+    }
+
+    /* Compound subtraction operator (in place)
+    ** @param other: vector object to subtract
+    ** @return: this vector
+    */
+    Vector<T> &operator-=(const Vector<T> &other)
+    {
+        // Checks to see if the sizes of both vectors are compatible
+        if (size != other.size)
+        {
+            throw std::invalid_argument("Error (Vector.h/operator-=): different vector sizes");
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+            elements[i] -= other.elements[i];
+        }
+
+        return *this;
+    }
+
+    /* Compound multiplication operator (element-wise, in place)
+    ** @param other: vector object to multiply by
+    ** @return: this vector
+    */
+    Vector<T> &operator*=(const Vector<T> &other)
+    {
+        // Checks to see if the sizes of both vectors are compatible
+        if (size != other.size)
+        {
+            throw std::invalid_argument("Error (Vector.h/operator*=): different vector sizes");
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+            elements[i] *= other.elements[i];
+        }
+
+        return *this;
+    }
+
+    /* Compound scalar multiplication operator (in place)
+    ** @param scalar: value to multiply every element by
+    ** @return: this vector
+    */
+    Vector<T> &operator*=(const T &scalar)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            elements[i] *= scalar;
+        }
+
+        return *this;
+    }
+
     /* Subscript operator
     ** @param index: index of the element to access
     ** @return: element at the specified index
     */
     T &operator[](int index)
     {
-        // Checks to see if the index is within bounds
-        if (index < 0 || index >= size)
+        // Checks to see if the index is within bounds (debug builds only)
+        if (BOUNDS_CHECK && (index < 0 || index >= size))
         {
             throw std::out_of_range("Error (Vector.h_[]): index out of bounds");
         }
 
-        return data[index];
+        return elements[index];
     }
 
     const T &operator[](int index) const
     {
-        // Checks to see if the index is within bounds
-        if (index < 0 || index >= size)
+        // Checks to see if the index is within bounds (debug builds only)
+        if (BOUNDS_CHECK && (index < 0 || index >= size))
         {
             throw std::out_of_range("Error (Vector.h_[]const): index out of bounds, 1");
         }
 
-        return data[index];
+        return elements[index];
     }
 
+    /* Raw data pointer
+    ** @return: pointer to the first element of the vector
+    */
+    T *data() { return elements; }
+    const T *data() const { return elements; }
+
+    /* Iterators (raw pointers, so loops over them can be vectorized)
+    ** @return: pointer to the first element / one past the last element
+    */
+    T *begin() { return elements; }
+    const T *begin() const { return elements; }
+    T *end() { return elements + size; }
+    const T *end() const { return elements + size; }
+
     /* Size Getter
     ** @return: size of the vector
     */
@@ -1,29 +1,282 @@
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include "stb_image_resize.h"
-
+#include "Batch.h"
+#include "FileIO.h"
+#include "Formats.h"
 #include "Image.h"
+#include "Pipeline.h"
+#include "Png.h"
+#include "Resample.h"
+#include "Server.h"
+#include "StageTimer.h"
+#include "ThreadPool.h"
+#include "Thumbnails.h"
+
+// Usage lines of the pipe and batch modes (also printed when their pipeline is invalid)
+static const char *const PIPE_USAGE = "./program [options] pipe <input file> '<stage> | <stage> | ...' <output directory>";
+static const char *const BATCH_USAGE = "./program [options] [--decoders <count>] [--workers <count>] [--encoders <count>] [--queue <count>] batch <input directory or manifest> '<stage> | ...' <output directory>";
+
+/* Parses a pipeline, printing the error and a usage line if it is invalid
+** @param spec: stages separated by '|' (see Pipeline.h)
+** @param usage: usage line of the mode
+** @return: the pipeline, or nullptr if it is invalid
+*/
+static std::unique_ptr<Pipeline> parsePipeline(const std::string &spec, const char *usage)
+{
+    try
+    {
+        return std::make_unique<Pipeline>(spec);
+    }
+    catch (const std::invalid_argument &error)
+    {
+        std::cout << error.what() << std::endl;
+        std::cout << "Usage: " << usage << std::endl;
+        return nullptr;
+    }
+}
+
+/* Saves an image, printing the error if it cannot be written in the requested format
+** @param image: image to save
+** @param path: output file (its extension selects the format)
+** @return: whether the image was saved
+*/
+static bool saveImage(const Image &image, const std::string &path)
+{
+    try
+    {
+        image.save(path);
+        return true;
+    }
+    catch (const std::invalid_argument &error)
+    {
+        std::cout << error.what() << std::endl;
+        return false;
+    }
+}
 
 int main(int argc, char **argv)
 {
-    if (argc < 4)
+    // Separates the options (--name) from the positional arguments
+    std::vector<std::string> args;
+    batch::Options batchOptions;
+    std::string outputFormat = "png";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--timing")
+        {
+            StageTimer::setEnabled(true);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            // Number of threads for the parallel kernels (0 = one per core)
+            ThreadPool::setSharedThreadCount(std::stoi(argv[++i]));
+        }
+        else if (arg == "--grain" && i + 1 < argc)
+        {
+            // Bytes per row band for the parallel per-pixel operations
+            ThreadPool::setGrainSize(std::stoul(argv[++i]));
+        }
+        else if (arg == "--io" && i + 1 < argc)
+        {
+            // How input files are read: stdio, mmap or pread (see FileIO.h)
+            std::string mode = argv[++i];
+            try
+            {
+                fileio::setReadMode(fileio::parseReadMode(mode));
+            }
+            catch (const std::invalid_argument &)
+            {
+                std::cout << "Unknown read mode " << mode << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            // Output file format: png, qoi, or one of the uncompressed formats ppm, pgm, pam or raw (see Formats.h)
+            outputFormat = argv[++i];
+            if (outputFormat != "png" && formats::fromPath("." + outputFormat) == formats::Format::stb)
+            {
+                std::cout << "Unknown output format " << outputFormat << std::endl;
+                return 1;
+            }
+            batchOptions.outputExtension = "." + outputFormat;
+        }
+        else if (arg == "--png-effort" && i + 1 < argc)
+        {
+            // PNG compression effort: stored, rle, fast or best (or 0 to 3, see Png.h)
+            std::string effort = argv[++i];
+            try
+            {
+                png::setEffort(png::parseEffort(effort));
+            }
+            catch (const std::invalid_argument &)
+            {
+                std::cout << "Unknown PNG effort " << effort << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--resize-filter" && i + 1 < argc)
+        {
+            // Resampling filter: box, bilinear, bicubic, lanczos3, or stbir for stb_image_resize (see Resample.h)
+            std::string filter = argv[++i];
+            try
+            {
+                resample::setFilter(resample::parseFilter(filter));
+            }
+            catch (const std::invalid_argument &)
+            {
+                std::cout << "Unknown resize filter " << filter << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--decoders" && i + 1 < argc)
+        {
+            // Batch mode: threads decoding inputs
+            batchOptions.decodeWorkers = std::stoi(argv[++i]);
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            // Batch mode: threads running the pipeline
+            batchOptions.computeWorkers = std::stoi(argv[++i]);
+        }
+        else if (arg == "--encoders" && i + 1 < argc)
+        {
+            // Batch mode: threads encoding outputs
+            batchOptions.encodeWorkers = std::stoi(argv[++i]);
+        }
+        else if (arg == "--queue" && i + 1 < argc)
+        {
+            // Batch mode: images waiting between two stages
+            batchOptions.queueDepth = std::stoul(argv[++i]);
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    // Serves requests over a Unix domain socket until a shutdown request (see Server.h)
+    if (args.size() == 2 && args[0] == "serve")
     {
-        std::cout << "Usage: ./program <function> <input file 1> <input file 2 (only needed for add, subtract, or dot)> <output directory>" << std::endl;
+        server::serve(args[1], std::cerr);
+
+        if (StageTimer::isEnabled())
+        {
+            StageTimer::report(std::cerr);
+        }
+        return 0;
+    }
+
+    if (args.size() < 3)
+    {
+        std::cout << "Usage: ./program [--timing] [--threads <count>] [--grain <bytes>] [--io stdio|mmap|pread] [--format png|qoi|ppm|pgm|pam|raw] [--png-effort 0-3] [--resize-filter box|bilinear|bicubic|lanczos3|stbir] <function> <input file 1> <input file 2 (only needed for add, subtract, or dot)> <output directory>" << std::endl;
+        std::cout << "       " << PIPE_USAGE << std::endl;
+        std::cout << "       " << BATCH_USAGE << std::endl;
+        std::cout << "       ./program [options] thumbs <input file> <width>x<height>,<width>,x<height>,... <output directory>" << std::endl;
+        std::cout << "       ./program [options] serve <socket path>" << std::endl;
         return 1;
     }
-    std::string function = argv[1];
-    std::string input_file_1 = argv[2];
-    std::string input_file_2 = argc > 4 ? argv[3] : "";
-    std::string output_directory = argv[argc - 1];
+    std::string function = args[0];
+    std::string input_file_1 = args[1];
+    std::string input_file_2 = args.size() > 3 ? args[2] : "";
+    std::string output_directory = args.back();
     std::cout << "image 1: " << input_file_1 << " image 2: " << input_file_2 << " output directory: " << output_directory << "   function: " << function << std::endl;
 
+    // Runs a chain of stages in memory (see Pipeline.h), so only the final image is encoded
+    if (function == "pipe")
+    {
+        if (args.size() != 4)
+        {
+            std::cout << "Invalid function name or insufficient number of arguments" << std::endl;
+            return 1;
+        }
+
+        std::unique_ptr<Pipeline> pipeline = parsePipeline(input_file_2, PIPE_USAGE);
+        if (!pipeline)
+        {
+            return 1;
+        }
+        Image image(input_file_1);
+        pipeline->run(image);
+
+        std::filesystem::create_directories(output_directory);
+        if (!saveImage(image, output_directory + "/output." + outputFormat))
+        {
+            return 1;
+        }
+
+        if (StageTimer::isEnabled())
+        {
+            StageTimer::report(std::cerr);
+        }
+        return 0;
+    }
+
+    // Runs a pipeline over every file of a directory or manifest, overlapping decode, compute and encode
+    if (function == "batch")
+    {
+        if (args.size() != 4)
+        {
+            std::cout << "Invalid function name or insufficient number of arguments" << std::endl;
+            return 1;
+        }
+
+        std::unique_ptr<Pipeline> pipeline = parsePipeline(input_file_2, BATCH_USAGE);
+        if (!pipeline)
+        {
+            return 1;
+        }
+        std::vector<std::string> inputs = batch::listInputs(input_file_1);
+        batch::Result result = batch::run(inputs, *pipeline, output_directory, batchOptions, std::cerr);
+        std::cout << "processed " << result.processed << " of " << inputs.size() << " images (" << result.failed << " failed)" << std::endl;
+
+        if (StageTimer::isEnabled())
+        {
+            StageTimer::report(std::cerr);
+        }
+        return result.failed == 0 ? 0 : 1;
+    }
+
+    // Builds several sizes of one image from a single decode and mip chain (see Thumbnails.h)
+    if (function == "thumbs")
+    {
+        if (args.size() != 4)
+        {
+            std::cout << "Invalid function name or insufficient number of arguments" << std::endl;
+            return 1;
+        }
+
+        Image image(input_file_1);
+        std::vector<std::string> outputs;
+        try
+        {
+            outputs = thumbnails::write(image, thumbnails::parseSizes(input_file_2), output_directory, "output", "." + outputFormat);
+        }
+        catch (const std::invalid_argument &error)
+        {
+            // An invalid size list, or an output format that cannot hold the image
+            std::cout << error.what() << std::endl;
+            return 1;
+        }
+        for (const std::string &output : outputs)
+        {
+            std::cout << output << std::endl;
+        }
+
+        if (StageTimer::isEnabled())
+        {
+            StageTimer::report(std::cerr);
+        }
+        return 0;
+    }
+
     // Load input image 1
     Image input_image_1(input_file_1);
 
@@ -53,14 +306,14 @@ int main(int argc, char **argv)
     else if (function == "scale")
     {
         float alpha = 1.0f; // default value
-        if (argc > 4)
+        if (args.size() > 3)
         {
             alpha = std::stof(input_file_2);
         }
         int newWidth = static_cast<int>(input_image_1.getWidth() * alpha);
         int newHeight = static_cast<int>(input_image_1.getHeight() * alpha);
         input_image_1.resize(newWidth, newHeight);
-        output_image = input_image_1;
+        output_image = std::move(input_image_1);
     }
     else
     {
@@ -70,8 +323,17 @@ int main(int argc, char **argv)
 
     // Write output image
     std::filesystem::create_directories(output_directory);
-    std::string output_filename = output_directory + "/output.png";
-    output_image.save(output_filename);
+    std::string output_filename = output_directory + "/output." + outputFormat;
+    if (!saveImage(output_image, output_filename))
+    {
+        return 1;
+    }
+
+    // Reports the time spent in each stage (--timing)
+    if (StageTimer::isEnabled())
+    {
+        StageTimer::report(std::cerr);
+    }
 
     return 0;
 }
@@ -0,0 +1,16 @@
+// stb_image_impl.cpp
+// Compiles the single-header stb libraries once so every target (main and the benchmarks) can link them
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// stb_image_resize takes its working memory from a ResizeContext when one is passed as the
+// allocation context (resizes without one use malloc and free)
+#include "ResizeContext.h"
+#include <cstdlib>
+#define STBIR_MALLOC(size, context) ((context) != nullptr ? static_cast<ResizeContext *>(context)->allocate(size) : std::malloc(size))
+#define STBIR_FREE(ptr, context) ((context) != nullptr ? static_cast<ResizeContext *>(context)->release(ptr) : std::free(ptr))
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb_image_resize.h"
@@ -0,0 +1,133 @@
+#include "stb_image_resize.h"
+
+#include <string.h>
+
+// The SSE2 transpose tiles are chosen at compile time on purpose: SSE2 is part of every x86-64
+// target, and this port has no IMAGE_SIMD switch, so a runtime check could never pick the scalar path
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "helpers.h"
+
+// edge length (in pixels) of the blocks the transpose works through, so the source and destination rows of a block stay in cache
+#define TRANSPOSE_BLOCK 64
+
+/*
+*   Resizes an image to the given dimensions using stb_image_resize. The input image is freed.
+*
+*   @param input_image the imatrix object to resize
+*   @param new_width the width of the resized image
+*   @param new_height the height of the resized image
+*   @returns a newly allocated imatrix object with the resized image.
+*            Note: This memory must be freed when you're done using it.
+*/
+imatrix* resize_image_to_imatrix(imatrix* input_image, int new_width, int new_height){
+    int width = input_image->width;
+    int height = input_image->height;
+
+    imatrix* resized_image = alloc_rgb_image(new_width, new_height);
+
+    // Resize the interleaved RGB buffer straight into the new image's buffer, then split it into its r, g, b arrays
+    stbir_resize_uint8(input_image->rgb_image, width, height, width * CHANNEL_NUM, resized_image->rgb_image, new_width, new_height, new_width * CHANNEL_NUM, CHANNEL_NUM);
+    resized_image->write_image_to_rgb(resized_image);
+    free_imatrix(input_image);
+    return resized_image;
+}
+
+// Transpose a (rows x cols) tile one byte at a time: dst[j][i] = src[i][j]
+static void transpose_tile_scalar(uint8_t** src, int src_row, int src_col, uint8_t** dst, int rows, int cols){
+    for (int i = 0; i < rows; i++){
+        uint8_t* in = src[src_row + i] + src_col;
+        for (int j = 0; j < cols; j++){
+            dst[src_col + j][src_row + i] = in[j];
+        }
+    }
+}
+
+#if defined(__SSE2__)
+// Transpose a 16 x 16 byte tile in registers with four rounds of 8, 16, 32 and 64 bit unpacks
+static void transpose_tile_16x16(uint8_t** src, int src_row, int src_col, uint8_t** dst){
+    __m128i r[16], a[16], b[16];
+    int i, g, j, h;
+
+    for (i = 0; i < 16; i++){
+        r[i] = _mm_loadu_si128((const __m128i*)(src[src_row + i] + src_col));
+    }
+
+    // b[i]: rows 2i, 2i+1 of columns 0-7, b[8 + i]: the same rows of columns 8-15
+    for (i = 0; i < 8; i++){
+        b[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+        b[8 + i] = _mm_unpackhi_epi8(r[2 * i], r[2 * i + 1]);
+    }
+
+    // a[4g + i]: rows 4i to 4i+3 of columns 4g to 4g+3
+    for (h = 0; h < 2; h++){
+        for (i = 0; i < 4; i++){
+            a[h * 8 + i] = _mm_unpacklo_epi16(b[h * 8 + 2 * i], b[h * 8 + 2 * i + 1]);
+            a[h * 8 + 4 + i] = _mm_unpackhi_epi16(b[h * 8 + 2 * i], b[h * 8 + 2 * i + 1]);
+        }
+    }
+
+    // b[4g + 2h + j]: rows 8j to 8j+7 of columns 4g+2h and 4g+2h+1
+    for (g = 0; g < 4; g++){
+        for (j = 0; j < 2; j++){
+            b[g * 4 + j] = _mm_unpacklo_epi32(a[g * 4 + 2 * j], a[g * 4 + 2 * j + 1]);
+            b[g * 4 + 2 + j] = _mm_unpackhi_epi32(a[g * 4 + 2 * j], a[g * 4 + 2 * j + 1]);
+        }
+    }
+
+    // Join the two row halves of every column and store it as a destination row
+    for (g = 0; g < 4; g++){
+        for (h = 0; h < 2; h++){
+            int column = src_col + g * 4 + h * 2;
+            __m128i top = b[g * 4 + h * 2];
+            __m128i bottom = b[g * 4 + h * 2 + 1];
+            _mm_storeu_si128((__m128i*)(dst[column] + src_row), _mm_unpacklo_epi64(top, bottom));
+            _mm_storeu_si128((__m128i*)(dst[column + 1] + src_row), _mm_unpackhi_epi64(top, bottom));
+        }
+    }
+}
+#endif
+
+// Transpose one color plane block by block, using the 16 x 16 register kernel where a full tile fits
+static void transpose_plane(uint8_t** src, uint8_t** dst, int height, int width){
+    for (int i0 = 0; i0 < height; i0 += TRANSPOSE_BLOCK){
+        int rows = height - i0 < TRANSPOSE_BLOCK ? height - i0 : TRANSPOSE_BLOCK;
+        for (int j0 = 0; j0 < width; j0 += TRANSPOSE_BLOCK){
+            int cols = width - j0 < TRANSPOSE_BLOCK ? width - j0 : TRANSPOSE_BLOCK;
+#if defined(__SSE2__)
+            int full_rows = rows / 16 * 16;
+            int full_cols = cols / 16 * 16;
+            for (int i = 0; i < full_rows; i += 16){
+                for (int j = 0; j < full_cols; j += 16){
+                    transpose_tile_16x16(src, i0 + i, j0 + j, dst);
+                }
+            }
+            // Right edge (all rows) and bottom edge (full-tile columns only)
+            transpose_tile_scalar(src, i0, j0 + full_cols, dst, rows, cols - full_cols);
+            transpose_tile_scalar(src, i0 + full_rows, j0, dst, rows - full_rows, full_cols);
+#else
+            transpose_tile_scalar(src, i0, j0, dst, rows, cols);
+#endif
+        }
+    }
+}
+
+/*
+*   Transposes an image (rows become columns). The input image is freed.
+*
+*   @param input_image the imatrix object to transpose
+*   @returns a newly allocated imatrix object with the transposed image.
+*            Note: This memory must be freed when you're done using it.
+*/
+imatrix* transpose(imatrix* input_image){
+    imatrix* transposed = alloc_rgb_image(input_image->height, input_image->width);
+
+    transpose_plane(input_image->r, transposed->r, input_image->height, input_image->width);
+    transpose_plane(input_image->g, transposed->g, input_image->height, input_image->width);
+    transpose_plane(input_image->b, transposed->b, input_image->height, input_image->width);
+
+    free_imatrix(input_image);
+    return transposed;
+}
@@ -1,3 +1,5 @@
+// expose mmap, madvise and pread under -std=c99
+#define _DEFAULT_SOURCE
 
 // // define STB_IMAGE_IMPLEMENTATION to enable implementation of stb_image functions
 // //#define STB_IMAGE_IMPLEMENTATION
@@ -13,12 +15,135 @@
 
 #include "imageutil.h"
 
+#include <limits.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEUTIL_X86 1
+#include <immintrin.h>
+#else
+#define IMAGEUTIL_X86 0
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+// bytes requested per pread call (large enough that the syscall cost is negligible)
+#define PREAD_CHUNK (8 * 1024 * 1024)
+
+// how init_from_file reads its input (stdio unless changed with set_io_mode)
+static enum IO_MODE io_mode = IO_STDIO;
+
+// buffer reused by every pread load, grown to the largest file read so far
+static uint8_t* pread_buffer = NULL;
+static size_t pread_capacity = 0;
+
+// Set how init_from_file reads input files
+void set_io_mode(enum IO_MODE mode){
+    io_mode = mode;
+}
+
+/*
+*   Parses an I/O mode name ("stdio", "mmap" or "pread").
+*   @param name the mode name
+*   @param mode receives the parsed mode
+*   @returns 0 on success, -1 for an unknown name
+*/
+int parse_io_mode(const char* name, enum IO_MODE* mode){
+    if (strcmp(name, "stdio") == 0)
+        *mode = IO_STDIO;
+    else if (strcmp(name, "mmap") == 0)
+        *mode = IO_MMAP;
+    else if (strcmp(name, "pread") == 0)
+        *mode = IO_PREAD;
+    else
+        return -1;
+    return 0;
+}
+
+#ifndef _WIN32
+// Decode a file through a read-only mapping, advising the kernel that it is read front to back
+static uint8_t* load_mmap(char* image_path, int* width, int* height, int* channels){
+    struct stat info;
+    uint8_t* rgb_image = NULL;
+    int fd = open(image_path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &info) < 0 || info.st_size <= 0 || info.st_size > INT_MAX){
+        close(fd);
+        return NULL;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return NULL;
+    madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+    rgb_image = stbi_load_from_memory((const uint8_t*)mapping, (int)info.st_size, width, height, channels, CHANNEL_NUM);
+    munmap(mapping, (size_t)info.st_size);
+    return rgb_image;
+}
+
+// Decode a file read with large pread calls into the reused buffer
+static uint8_t* load_pread(char* image_path, int* width, int* height, int* channels){
+    struct stat info;
+    size_t size, done = 0;
+    int fd = open(image_path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &info) < 0 || info.st_size <= 0 || info.st_size > INT_MAX){
+        close(fd);
+        return NULL;
+    }
+    size = (size_t)info.st_size;
+
+    if (size > pread_capacity){
+        uint8_t* grown = (uint8_t*)realloc(pread_buffer, size);
+        if (grown == NULL){
+            close(fd);
+            return NULL;
+        }
+        pread_buffer = grown;
+        pread_capacity = size;
+    }
+
+    while (done < size){
+        size_t chunk = size - done < PREAD_CHUNK ? size - done : PREAD_CHUNK;
+        ssize_t n = pread(fd, pread_buffer + done, chunk, (off_t)done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0){
+            close(fd);
+            return NULL;
+        }
+        done += (size_t)n;
+    }
+    close(fd);
+
+    return stbi_load_from_memory(pread_buffer, (int)size, width, height, channels, CHANNEL_NUM);
+}
+#endif
+
 // Initialize an imatrix from an image file on disk
 imatrix* init_from_file(char* image_path, int* width, int* height, int* channels){
     // int i,j;
 
-    // Load the image from the file using stb_image library
+    // Load the image from the file using stb_image library (read as chosen by set_io_mode)
     uint8_t* rgb_image;
+#ifndef _WIN32
+    if (io_mode == IO_MMAP)
+        rgb_image = load_mmap(image_path, width, height, channels);
+    else if (io_mode == IO_PREAD)
+        rgb_image = load_pread(image_path, width, height, channels);
+    else
+#endif
     rgb_image = stbi_load(image_path, width, height, channels, CHANNEL_NUM);
     // printf("init_from_file:: image_path: %s\n\t", image_path);
     // printf("init_from_file:: width: %d, height: %d, channels: %d\n", *width, *height, *channels);
@@ -29,7 +154,7 @@ imatrix* init_from_file(char* image_path, int* width, int* height, int* channels
 
     // Set the internal RGB image reference and initialize the imatrix data structure
     image_matrix->rgb_image = rgb_image;
-    image_matrix = init_rgb(image_matrix, *width, *height);
+    image_matrix = alloc_rgb(image_matrix, *width, *height);
 
     // Write the image data to the imatrix
     image_matrix->write_image_to_rgb(image_matrix);
@@ -50,7 +175,7 @@ imatrix* init_from_rgb_image(uint8_t* rgb_image, int width, int height){
 
     // Set the internal RGB image reference and initialize the imatrix data structure
     image_matrix->rgb_image = rgb_image;
-    image_matrix = init_rgb(image_matrix, width, height);
+    image_matrix = alloc_rgb(image_matrix, width, height);
 
     // Write the image data to the imatrix
     image_matrix->write_image_to_rgb(image_matrix);
@@ -72,6 +197,20 @@ imatrix* init_blank_rgb_image(int width, int height){
     return image_matrix;
 }
 
+// Initialize an imatrix whose pixels are left uninitialized (for results that overwrite every pixel)
+imatrix* alloc_rgb_image(int width, int height){
+
+    // Allocate memory for the imatrix and initialize function pointers
+    imatrix* image_matrix = malloc(sizeof(imatrix));
+    init_funcptrs(image_matrix);
+
+    // Allocate memory for the internal RGB image reference and the r, g, b planes (not filled)
+    image_matrix->rgb_image = (uint8_t*) malloc(sizeof(uint8_t) * width * height * CHANNEL_NUM);
+    image_matrix = alloc_rgb(image_matrix, width, height);
+
+    return image_matrix;
+}
+
 
 // Initialize the function pointers of an imatrix
 void init_funcptrs(imatrix* this){
@@ -97,16 +236,15 @@ void init_funcptrs(imatrix* this){
 }
 
 /*
-*   Initializes a new RGB imatrix object with the given width, height.
+*   Allocates the r, g, b planes of an imatrix without initializing the pixels (for images whose
+*   pixels are all written right afterwards). One allocation holds the row pointers of the three
+*   planes followed by the planes themselves, with every row starting on a cache line.
 *   @param this the imatrix object to initialize
 *   @param width the width of the image
 *   @param height the height of the image
-*   @param channels the number of color channels in the image (must be 3 for RGB)
-*   @returns a reference to the initialized imatrix object
+*   @returns a reference to the initialized imatrix object, or NULL if the allocation failed
 */
-imatrix* init_rgb(imatrix* this, int width, int height){
-
-    // FILL IN THE CODE HERE
+imatrix* alloc_rgb(imatrix* this, int width, int height){
 
     // Check for invalid imatrix
     if(this == NULL) {
@@ -117,127 +255,288 @@ imatrix* init_rgb(imatrix* this, int width, int height){
     // Initialize the width and height
     this->width = width;
     this->height = height;
+    this->storage = NULL;
+    this->r = this->g = this->b = NULL;
+
+    // Bytes between the starts of two rows of a plane (the width rounded up to whole cache lines)
+    this->stride = (width + IMATRIX_ALIGN - 1) / IMATRIX_ALIGN * IMATRIX_ALIGN;
+
+    size_t rows = height > 0 ? (size_t)height : 0;
+    size_t pointer_bytes = (3 * rows * sizeof(uint8_t*) + IMATRIX_ALIGN - 1) / IMATRIX_ALIGN * IMATRIX_ALIGN;
+    size_t plane_bytes = rows * (size_t)this->stride;
+
+    // The extra IMATRIX_ALIGN - 1 bytes leave room to align the start of the planes
+    this->storage = malloc(pointer_bytes + 3 * plane_bytes + IMATRIX_ALIGN - 1);
+    if(this->storage == NULL) {
+        return NULL;
+    }
+
+    uint8_t** pointers = (uint8_t**)this->storage;
+    uintptr_t base = ((uintptr_t)this->storage + pointer_bytes + IMATRIX_ALIGN - 1) / IMATRIX_ALIGN * IMATRIX_ALIGN;
+    uint8_t* planes = (uint8_t*)base;
+
+    // Point the rows of r, g and b into their planes
+    this->r = pointers;
+    this->g = pointers + rows;
+    this->b = pointers + 2 * rows;
+    for(size_t i = 0; i < rows; i++) {
+        this->r[i] = planes + i * this->stride;
+        this->g[i] = planes + plane_bytes + i * this->stride;
+        this->b[i] = planes + 2 * plane_bytes + i * this->stride;
+    }
+
+    return this;
+}
+
+/*
+*   Initializes a new RGB imatrix object with the given width, height.
+*   @param this the imatrix object to initialize
+*   @param width the width of the image
+*   @param height the height of the image
+*   @param channels the number of color channels in the image (must be 3 for RGB)
+*   @returns a reference to the initialized imatrix object
+*/
+imatrix* init_rgb(imatrix* this, int width, int height){
+
+    // FILL IN THE CODE HERE
 
     // Allocate memory for the r, g, b two-dimensional arrays
-    this->r = (uint8_t**)malloc(this->height * sizeof(uint8_t*));
-    if(this->r == NULL) {
+    if(alloc_rgb(this, width, height) == NULL) {
         return NULL;
     }
-    for(int i = 0; i < this->height; i++) {
-        this->r[i] = (uint8_t*)malloc(this->width * sizeof(uint8_t));
-        if(this->r[i] == NULL) {
-            for(int j = 0; j < i; j++) {
-                free(this->r[j]);
-            }
-            free(this->r);
-            return NULL;
+
+    // Initialize pixel values for r, g, b arrays to 255 (the three planes follow each other, so one fill covers them)
+    if(height > 0) {
+        memset(this->r[0], 255, 3 * (size_t)height * this->stride);
+    }
+
+    return this;
+}
+
+// Set the pixel data of an imatrix from an RGB byte array
+imatrix* set_rgb_image(imatrix* this, uint8_t* new_rgb_image, int height, int width){
+    // Free any memory previously allocated for the imatrix and initialize from the new RGB image
+    free_imatrix(this);
+    return init_from_rgb_image(new_rgb_image, height, width);
+}
+
+
+// Split pixels first to width - 1 of an RGB row into the r, g, b rows one byte at a time
+static void split_row_scalar(const uint8_t* in, uint8_t* r, uint8_t* g, uint8_t* b, int first, int width){
+    for (int j = first; j < width; ++j){
+        r[j] = in[CHANNEL_NUM * j + RED];
+        g[j] = in[CHANNEL_NUM * j + GREEN];
+        b[j] = in[CHANNEL_NUM * j + BLUE];
+    }
+}
+
+// Join pixels first to width - 1 of the r, g, b rows into an RGB row one byte at a time
+static void join_row_scalar(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out, int first, int width){
+    for (int j = first; j < width; ++j){
+        out[CHANNEL_NUM * j + RED] = r[j];
+        out[CHANNEL_NUM * j + GREEN] = g[j];
+        out[CHANNEL_NUM * j + BLUE] = b[j];
+    }
+}
+
+#if IMAGEUTIL_X86
+// Byte shuffles for 16 RGB pixels (48 bytes in three vectors). split_masks[c][v] moves the bytes of
+// channel c held by vector v of the RGB row to their place in the channel row, and join_masks[v][c]
+// moves bytes of channel row c to their place in vector v of the RGB row. 0x80 writes a zero.
+static const uint8_t split_masks[3][3][16] = {
+    {{0, 3, 6, 9, 12, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 2, 5, 8, 11, 14, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 1, 4, 7, 10, 13}},
+    {{1, 4, 7, 10, 13, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0, 3, 6, 9, 12, 15, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 2, 5, 8, 11, 14}},
+    {{2, 5, 8, 11, 14, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 1, 4, 7, 10, 13, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+     {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0, 3, 6, 9, 12, 15}}};
+static const uint8_t join_masks[3][3][16] = {
+    {{0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80, 5},
+     {0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80},
+     {0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80}},
+    {{0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10, 0x80},
+     {5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10},
+     {0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80}},
+    {{0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80, 0x80},
+     {0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80},
+     {10, 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15}}};
+
+// Split an RGB row 16 pixels at a time with SSSE3 byte shuffles
+__attribute__((target("ssse3")))
+static void split_row_ssse3(const uint8_t* in, uint8_t* r, uint8_t* g, uint8_t* b, int width){
+    uint8_t* out[3] = {r, g, b};
+    __m128i masks[3][3];
+    for (int m = 0; m < 9; ++m){
+        masks[m / 3][m % 3] = _mm_loadu_si128((const __m128i*)split_masks[m / 3][m % 3]);
+    }
+
+    int j = 0;
+    for (; j + 16 <= width; j += 16){
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(in + CHANNEL_NUM * j));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(in + CHANNEL_NUM * j + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(in + CHANNEL_NUM * j + 32));
+        for (int c = 0; c < 3; ++c){
+            __m128i channel = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, masks[c][0]), _mm_shuffle_epi8(v1, masks[c][1])),
+                                           _mm_shuffle_epi8(v2, masks[c][2]));
+            _mm_storeu_si128((__m128i*)(out[c] + j), channel);
         }
     }
+    split_row_scalar(in, r, g, b, j, width);
+}
 
-    this->g = (uint8_t**)malloc(this->height * sizeof(uint8_t*));
-    if(this->g == NULL) {
-        return NULL;
+// Join r, g, b rows into an RGB row 16 pixels at a time with SSSE3 byte shuffles
+__attribute__((target("ssse3")))
+static void join_row_ssse3(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out, int width){
+    __m128i masks[3][3];
+    for (int m = 0; m < 9; ++m){
+        masks[m / 3][m % 3] = _mm_loadu_si128((const __m128i*)join_masks[m / 3][m % 3]);
     }
 
-    for(int i = 0; i < this->height; i++) {
-        this->g[i] = (uint8_t*)malloc(this->width * sizeof(uint8_t));
-        if(this->g[i] == NULL) {
-            for(int j = 0; j < i; j++) {
-                free(this->g[j]);
-            }
-            free(this->g);
-            return NULL;
+    int j = 0;
+    for (; j + 16 <= width; j += 16){
+        __m128i vr = _mm_loadu_si128((const __m128i*)(r + j));
+        __m128i vg = _mm_loadu_si128((const __m128i*)(g + j));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        for (int v = 0; v < 3; ++v){
+            __m128i bytes = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr, masks[v][0]), _mm_shuffle_epi8(vg, masks[v][1])),
+                                         _mm_shuffle_epi8(vb, masks[v][2]));
+            _mm_storeu_si128((__m128i*)(out + CHANNEL_NUM * j + 16 * v), bytes);
         }
     }
+    join_row_scalar(r, g, b, out, j, width);
+}
 
-    this->b = (uint8_t**)malloc(this->height * sizeof(uint8_t*));
-    if(this->b == NULL) return NULL;
+// Split an RGB row 32 pixels at a time with AVX2. AVX2 byte shuffles stay within 128-bit lanes, so the
+// low lane works on pixels 0 to 15 and the high lane on pixels 16 to 31 with the same masks as SSSE3.
+__attribute__((target("avx2")))
+static void split_row_avx2(const uint8_t* in, uint8_t* r, uint8_t* g, uint8_t* b, int width){
+    uint8_t* out[3] = {r, g, b};
+    __m256i masks[3][3];
+    for (int m = 0; m < 9; ++m){
+        masks[m / 3][m % 3] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)split_masks[m / 3][m % 3]));
+    }
 
-    for(int i = 0; i < this->height; i++) {
-        this->b[i] = (uint8_t*)malloc(this->width * sizeof(uint8_t));
-        if(this->b[i] == NULL) {
-            for(int j = 0; j < i; j++) {
-                free(this->b[j]);
-            }
-            free(this->b);
-            return NULL;
+    int j = 0;
+    for (; j + 32 <= width; j += 32){
+        const uint8_t* pixels = in + CHANNEL_NUM * j;
+        __m256i v[3];
+        for (int k = 0; k < 3; ++k){
+            __m128i low = _mm_loadu_si128((const __m128i*)(pixels + 16 * k));
+            __m128i high = _mm_loadu_si128((const __m128i*)(pixels + 48 + 16 * k));
+            v[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
         }
+        for (int c = 0; c < 3; ++c){
+            __m256i channel = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v[0], masks[c][0]), _mm256_shuffle_epi8(v[1], masks[c][1])),
+                                              _mm256_shuffle_epi8(v[2], masks[c][2]));
+            _mm256_storeu_si256((__m256i*)(out[c] + j), channel);
+        }
+    }
+    split_row_scalar(in, r, g, b, j, width);
+}
+
+// Join r, g, b rows into an RGB row 32 pixels at a time with AVX2 (lanes as for split_row_avx2)
+__attribute__((target("avx2")))
+static void join_row_avx2(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out, int width){
+    __m256i masks[3][3];
+    for (int m = 0; m < 9; ++m){
+        masks[m / 3][m % 3] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)join_masks[m / 3][m % 3]));
     }
 
-    // Initialize pixel values for r, g, b arrays to 255
-    for(int i = 0; i < this->height; i++) {
-        for(int j = 0; j < this->width; j++) {
-            this->r[i][j] = (uint8_t)255;
-            this->g[i][j] = (uint8_t)255;
-            this->b[i][j] = (uint8_t)255;
+    int j = 0;
+    for (; j + 32 <= width; j += 32){
+        __m256i vr = _mm256_loadu_si256((const __m256i*)(r + j));
+        __m256i vg = _mm256_loadu_si256((const __m256i*)(g + j));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+        uint8_t* pixels = out + CHANNEL_NUM * j;
+        for (int k = 0; k < 3; ++k){
+            __m256i bytes = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(vr, masks[k][0]), _mm256_shuffle_epi8(vg, masks[k][1])),
+                                            _mm256_shuffle_epi8(vb, masks[k][2]));
+            _mm_storeu_si128((__m128i*)(pixels + 16 * k), _mm256_castsi256_si128(bytes));
+            _mm_storeu_si128((__m128i*)(pixels + 48 + 16 * k), _mm256_extracti128_si256(bytes, 1));
         }
     }
+    join_row_scalar(r, g, b, out, j, width);
+}
+#endif
 
-    return this;
+// Row converters used by write_image_to_rgb and write_rgb_to_image
+typedef void (*split_row_fn)(const uint8_t* in, uint8_t* r, uint8_t* g, uint8_t* b, int width);
+typedef void (*join_row_fn)(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out, int width);
+
+static void split_row_fallback(const uint8_t* in, uint8_t* r, uint8_t* g, uint8_t* b, int width){
+    split_row_scalar(in, r, g, b, 0, width);
 }
 
-// Set the pixel data of an imatrix from an RGB byte array
-imatrix* set_rgb_image(imatrix* this, uint8_t* new_rgb_image, int height, int width){
-    // Free any memory previously allocated for the imatrix and initialize from the new RGB image
-    free_imatrix(this);
-    return init_from_rgb_image(new_rgb_image, height, width);
+static void join_row_fallback(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out, int width){
+    join_row_scalar(r, g, b, out, 0, width);
 }
 
+static split_row_fn split_row = NULL;
+static join_row_fn join_row = NULL;
+
+// Pick the widest row converters the CPU supports (once, on first use)
+static void select_row_converters(void){
+    if (split_row != NULL)
+        return;
+
+    split_row = split_row_fallback;
+    join_row = join_row_fallback;
+#if IMAGEUTIL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")){
+        split_row = split_row_avx2;
+        join_row = join_row_avx2;
+    }
+    else if (__builtin_cpu_supports("ssse3")){
+        split_row = split_row_ssse3;
+        join_row = join_row_ssse3;
+    }
+#endif
+}
 
 // Write the pixel data of an imatrix to its internal RGB image buffer
 void write_rgb_to_image(imatrix* m){
-    int i,j, height, width;
+    int i, height, width;
     height = m->height;
     width = m->width;
+    select_row_converters();
 
-    // Iterate through the image matrix and set the corresponding RGB pixel values in the RGB buffer
+    // Join the r, g, b rows into the corresponding rows of the RGB buffer
     for (i=0; i<height; ++i){
-        for(j=0; j<width; ++j){
-            *( m->rgb_image + (i * (CHANNEL_NUM * width) + (CHANNEL_NUM * j)) + RED) = m->r[i][j];
-            *( m->rgb_image + (i * (CHANNEL_NUM * width) + (CHANNEL_NUM * j)) + GREEN) = m->g[i][j];
-            *( m->rgb_image + (i * (CHANNEL_NUM * width) + (CHANNEL_NUM * j)) + BLUE) = m->b[i][j];
-        }
+        join_row(m->r[i], m->g[i], m->b[i], m->rgb_image + (size_t)i * CHANNEL_NUM * width, width);
     }
 }
 
 // Write the pixel data of the internal RGB image buffer to an imatrix
 void write_image_to_rgb(imatrix* m){
-    int i,j, height, width;
+    int i, height, width;
     height = m->height;
     width = m->width;
+    select_row_converters();
 
-    // Iterate through the RGB buffer and set the corresponding pixel values in the image matrix
+    // Split each row of the RGB buffer into the r, g, b rows of the image matrix
     for (i=0; i<height; ++i){
-        for(j=0; j<width; ++j){
-            m->r[i][j] = *( m->rgb_image + (i * (CHANNEL_NUM * width) + (CHANNEL_NUM * j)) + RED);
-            m->g[i][j] = *( m->rgb_image + (i * (CHANNEL_NUM * width) + (CHANNEL_NUM * j)) + GREEN);
-            m->b[i][j] = *( m->rgb_image + (i * (CHANNEL_NUM * width) + (CHANNEL_NUM * j)) + BLUE);
-        }
+        split_row(m->rgb_image + (size_t)i * CHANNEL_NUM * width, m->r[i], m->g[i], m->b[i], width);
     }
 }
 
 // Free all allocated memory for an imatrix
 void free_imatrix(imatrix* image_matrix){
-    int i;
 
     // If the input imatrix is null, return
     if (image_matrix==NULL)
         return;  
 
-    // Free the memory allocated for this->r, this->g, and this->b
-    for (i = 0; i < image_matrix->height; ++i) {
-        if (image_matrix->r[i] != NULL){
-            free(image_matrix->r[i]);
-            image_matrix->r[i] = NULL;
-        }
-        if (image_matrix->g[i] != NULL){
-            free(image_matrix->g[i]);
-            image_matrix->g[i] = NULL;
-        }
-        if (image_matrix->b[i] != NULL){
-            free(image_matrix->b[i]);
-            image_matrix->b[i] = NULL;
-        }
+    // Free the single allocation holding this->r, this->g, and this->b
+    if (image_matrix->storage != NULL){
+        free(image_matrix->storage);
+        image_matrix->storage = NULL;
+        image_matrix->r = NULL;
+        image_matrix->g = NULL;
+        image_matrix->b = NULL;
     }
 
     // // Free the memory allocated for image_matrix->rgb_image
@@ -277,8 +576,8 @@ imatrix* add(imatrix* m1, imatrix* m2){
         return NULL;
     }
 
-    // Create new imatrix object
-    imatrix* this = init_blank_rgb_image(m1->width, m1->height);
+    // Create new imatrix object (every pixel is written below)
+    imatrix* this = alloc_rgb_image(m1->width, m1->height);
     
     // Scale all pixels of the r, g, b two-dimensional arrays of both imatrix objects to half
     m1 = scale(m1, m1->width, m1->height, 0.5);
@@ -327,8 +626,8 @@ imatrix* subtract(imatrix* m1, imatrix* m2) {
         return NULL;
     }
 
-    // Create new imatrix object
-    imatrix* this = init_blank_rgb_image(m1->width, m1->height);
+    // Create new imatrix object (every pixel is written below)
+    imatrix* this = alloc_rgb_image(m1->width, m1->height);
 
     // Subtract the respective pixel values of the matrix m2 from the matrix m1
     for (int i = 0; i < this->height; i++){
@@ -12,6 +12,9 @@
 // define the number of color channels as 3
 #define CHANNEL_NUM 3
 
+// alignment in bytes of every row of the r, g, b planes (one cache line)
+#define IMATRIX_ALIGN 64
+
 // define a struct to wrap a byte array of pixel data for an image
 typedef struct imatrix{
     int width;
@@ -36,12 +39,25 @@ typedef struct imatrix{
 
     // internal image reference
     uint8_t* rgb_image;
+
+    // single allocation holding the row pointers and the r, g, b planes (rows start IMATRIX_ALIGN-aligned)
+    void* storage;
+
+    // bytes between the starts of two rows of a plane
+    int stride;
 } imatrix;
 
+// ways init_from_file reads an input file: stb_image's buffered stdio reads, a read-only mapping
+// decoded in place, or large pread calls into a buffer reused across files
+enum IO_MODE {IO_STDIO, IO_MMAP, IO_PREAD};
+
 // function prototypes
+void set_io_mode(enum IO_MODE mode);
+int parse_io_mode(const char* name, enum IO_MODE* mode);
 imatrix* init_from_file(char* image_path, int* width, int* height, int* channels);
 imatrix* init_from_rgb_image(uint8_t* rgb_image, int width, int height);
 imatrix* init_blank_rgb_image(int width, int height);
+imatrix* alloc_rgb_image(int width, int height);
 imatrix* set_rgb_image(imatrix* this, uint8_t* new_rgb_image, int height, int width);
 void free_imatrix(imatrix* image);
 
@@ -53,6 +69,7 @@ void init_funcptrs(imatrix* this);
 void write_rgb_to_image(imatrix* m);
 void write_image_to_rgb(imatrix* this);
 imatrix* init_rgb(imatrix* this, int width, int height);
+imatrix* alloc_rgb(imatrix* this, int width, int height);
 imatrix* add(imatrix* m1, imatrix* m2);
 imatrix* subtract(imatrix* m1, imatrix* m2);
 imatrix* multiply(imatrix* m1, imatrix* m2);
@@ -24,8 +24,20 @@
 *   @returns 0 on successful completion of the program
 */
 int main(int argc, char** argv){
+    // Optional leading "--io <stdio|mmap|pread>" chooses how input files are read
+    if (argc > 2 && strcmp(argv[1], "--io") == 0){
+        enum IO_MODE mode;
+        if (parse_io_mode(argv[2], &mode) != 0){
+            printf("Unknown I/O mode %s (expected stdio, mmap or pread)\n", argv[2]);
+            return 1;
+        }
+        set_io_mode(mode);
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc < 4){
-        printf("Usage: ./program <function> <input file 1> <input file 2 (only needed for add, subtract, or dot)> <output directory>\n");
+        printf("Usage: ./program [--io stdio|mmap|pread] <function> <input file 1> <input file 2 (only needed for add, subtract, or dot)> <output directory>\n");
         return 1;
     }
     char* function = argv[1];